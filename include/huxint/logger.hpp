@@ -1,2 +1,6 @@
 #pragma once
-#include "logger/logger.hpp"
\ No newline at end of file
+#include "logger/logger.hpp"
+#include "logger/posix_sink.hpp"
+#include "logger/rotating_sink.hpp"
+#include "logger/binary_sink.hpp"
+#include "logger/json_sink.hpp"
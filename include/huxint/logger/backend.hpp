@@ -0,0 +1,350 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "queue.hpp"
+
+namespace huxint {
+// 生产者队列满时的处理方式
+enum class Overflow : std::uint8_t {
+    Block,      // 等待后台取走, 不丢日志
+    DropNewest, // 丢弃本条
+    DropOldest, // 覆盖队列中最旧的一条
+};
+
+// 异步后端: 每个生产者线程写自己的 RingBuffer, 由一个后台线程统一取出, 成批交给 handler.
+// 空闲时每轮也以空批次调用 handler, 便于做周期性的工作. 生产者除首次注册队列外不加锁,
+// 在 DropNewest/DropOldest 下每次 push 的步数有上界 (wait-free), 慢 sink 卡住后台线程也不会拖住生产者
+template <typename T>
+class Backend {
+public:
+    using Handler = std::function<void(std::span<T>)>;
+    using Flusher = std::function<void(bool durable)>;
+    using Callback = std::function<void()>;
+
+    Backend(Handler handler, Flusher flusher, std::size_t capacity = 4096)
+    : handler_(std::move(handler)),
+      flusher_(std::move(flusher)),
+      capacity_(capacity),
+      worker_([this](std::stop_token token) {
+          run(token);
+      }) {}
+
+    Backend(const Backend &) = delete;
+    Backend &operator=(const Backend &) = delete;
+
+    ~Backend() {
+        worker_.request_stop();
+        wake();
+        worker_.join();
+    }
+
+    // 生产者调用, 队列满时按 policy 处理. 除 Block 外步数有上界, 不加锁也不等待后台线程:
+    // DropNewest 时返回 false; DropOldest 时被覆盖的记录析构前交给 on_evict(T &), 最旧的一条恰好被后台线程认领时
+    // 改为丢弃本条. Block 时唤醒后台并让出 CPU, 直到写入成功; 在后台线程上 (如 flush_async 的回调中) 等不到自己,
+    // 按 DropNewest 处理
+    template <typename E, typename... Args>
+    bool push(Overflow policy, E &&on_evict, Args &&...args) {
+        auto &ring = local();
+        if (ring.try_emplace(std::forward<Args>(args)...)) {
+            return true;
+        }
+        nudge();
+        if (policy == Overflow::Block && on_backend_thread()) {
+            return false;
+        }
+        switch (policy) {
+            case Overflow::DropNewest:
+                return false;
+            case Overflow::DropOldest:
+                return ring.pop_oldest(on_evict) && ring.try_emplace(std::forward<Args>(args)...);
+            default:
+                while (!ring.try_emplace(std::forward<Args>(args)...)) {
+                    nudge();
+                    std::this_thread::yield();
+                }
+                return true;
+        }
+    }
+
+    // 阻塞直到调用前已入队的记录全部交给 handler, 并执行一次 flusher. durable 原样传给 flusher.
+    // 在后台线程上调用会等待自己, 直接抛出 std::logic_error
+    void flush(bool durable = false) {
+        if (on_backend_thread()) {
+            throw std::logic_error("huxint: blocking flush called on the logger backend thread");
+        }
+        std::unique_lock lock(mutex_);
+        const auto ticket = ++flush_requested_;
+        if (durable) {
+            durable_requested_ = ticket;
+        }
+        cv_.notify_one();
+        done_.wait(lock, [&] {
+            return flush_done_ >= ticket;
+        });
+    }
+
+    // 不阻塞的 flush: 调用前已入队的记录全部交给 handler 并执行过 flusher 后, 在后台线程调用 done.
+    // 与 flush 共用票号, done 中不能调用阻塞的 flush (见 flush), 耗时的工作应转交给其他线程
+    void flush_async(Callback done, bool durable = false) {
+        {
+            std::scoped_lock lock(mutex_);
+            const auto ticket = ++flush_requested_;
+            if (durable) {
+                durable_requested_ = ticket;
+            }
+            callbacks_.emplace_back(ticket, std::move(done));
+        }
+        cv_.notify_one();
+    }
+
+    // 之后新注册的生产者队列容量, 已有队列不变
+    void capacity(std::size_t capacity) {
+        capacity_.store(capacity, std::memory_order_relaxed);
+    }
+
+    std::size_t capacity() const {
+        return capacity_.load(std::memory_order_relaxed);
+    }
+
+    // 各生产者队列中尚未取出的条数之和
+    std::size_t depth() {
+        std::scoped_lock lock(producers_mutex_);
+        std::size_t depth = 0;
+        for (const auto &ring : producers_) {
+            depth += ring->size();
+        }
+        return depth;
+    }
+
+    // 后台线程一轮取出的最多条数, 反映队列积压的峰值
+    std::size_t peak_depth() const {
+        return peak_depth_.load(std::memory_order_relaxed);
+    }
+
+    // 崩溃时调用, 不经过后台线程, 把各队列中剩余的记录交给 fn(T &). 注册表锁短暂尝试后仍拿不到也照样遍历,
+    // 持锁的可能正是崩溃的线程
+    template <typename F>
+    void salvage(F &&fn) {
+        bool locked = false;
+        for (int i = 0; i < 1000 && !(locked = producers_mutex_.try_lock()); ++i) {
+            std::this_thread::yield();
+        }
+        for (const auto &ring : producers_) {
+            ring->salvage(fn);
+        }
+        if (locked) {
+            producers_mutex_.unlock();
+        }
+    }
+
+    void wake() {
+        {
+            std::scoped_lock lock(mutex_);
+            wake_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    // 生产者调用的 wake, 不加锁, 后台线程在等待时才 notify. 与后台线程入睡同时发生时可能错过,
+    // 此时最迟 idle_interval 后后台线程自己醒来
+    void nudge() {
+        nudged_.store(true);
+        if (sleeping_.load()) {
+            cv_.notify_one();
+        }
+    }
+
+    bool on_backend_thread() const {
+        return std::this_thread::get_id() == worker_.get_id();
+    }
+
+private:
+    // 当前线程在本后端上的队列, 首次使用时注册
+    RingBuffer<T> &local() {
+        struct Cache {
+            std::vector<std::pair<std::uint64_t, std::shared_ptr<RingBuffer<T>>>> rings;
+
+            ~Cache() {
+                for (auto &[id, ring] : rings) {
+                    ring->close();
+                }
+            }
+        };
+        thread_local Cache cache;
+        for (auto &[id, ring] : cache.rings) {
+            if (id == id_) {
+                return *ring;
+            }
+        }
+        auto ring = std::make_shared<RingBuffer<T>>(capacity());
+        {
+            std::scoped_lock lock(producers_mutex_);
+            producers_.push_back(ring);
+        }
+        cache.rings.emplace_back(id_, ring);
+        return *ring;
+    }
+
+    // 取出所有队列中的记录交给 handler, 返回条数
+    std::size_t drain() {
+        batch_.clear();
+        {
+            std::scoped_lock lock(producers_mutex_);
+            for (const auto &ring : producers_) {
+                ring->drain(
+                    [this](T &&item) {
+                        batch_.push_back(std::move(item));
+                    },
+                    ring->capacity());
+            }
+            std::erase_if(producers_, [](const auto &ring) {
+                return ring->closed() && ring->empty();
+            });
+        }
+        if (batch_.size() > peak_depth_.load(std::memory_order_relaxed)) {
+            peak_depth_.store(batch_.size(), std::memory_order_relaxed);
+        }
+        handler_(batch_);
+        return batch_.size();
+    }
+
+    void run(const std::stop_token &token) {
+        while (true) {
+            std::uint64_t requested = 0;
+            bool durable = false;
+            {
+                std::scoped_lock lock(mutex_);
+                requested = flush_requested_;
+                durable = durable_requested_ > flush_done_;
+                wake_ = false;
+            }
+            nudged_.store(false, std::memory_order_relaxed);
+            // 每个队列一次取空, 因此一轮之后 requested 之前入队的记录都已处理
+            const auto count = drain();
+            if (requested > flush_done_) {
+                flusher_(durable);
+                {
+                    std::scoped_lock lock(mutex_);
+                    flush_done_ = requested;
+                    take_callbacks(requested);
+                }
+                done_.notify_all();
+                run_callbacks();
+            }
+            if (token.stop_requested()) {
+                while (drain() != 0) {
+                }
+                flusher_(false);
+                {
+                    std::scoped_lock lock(mutex_);
+                    take_callbacks(flush_requested_);
+                }
+                run_callbacks();
+                return;
+            }
+            if (count != 0) {
+                continue;
+            }
+            std::unique_lock lock(mutex_);
+            sleeping_.store(true);
+            cv_.wait_for(lock, idle_interval, [&] {
+                return wake_ || nudged_.load() || flush_requested_ > flush_done_ || token.stop_requested();
+            });
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // 持有 mutex_ 时调用, 取出票号不超过 ticket 的回调. 票号递增, 完成的总在前面
+    void take_callbacks(std::uint64_t ticket) {
+        std::size_t n = 0;
+        while (n < callbacks_.size() && callbacks_[n].first <= ticket) {
+            ++n;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            ready_.push_back(std::move(callbacks_[i].second));
+        }
+        callbacks_.erase(callbacks_.begin(), callbacks_.begin() + static_cast<std::ptrdiff_t>(n));
+    }
+
+    // 不持锁调用, 回调中可以再次 flush_async
+    void run_callbacks() {
+        for (auto &done : ready_) {
+            done();
+        }
+        ready_.clear();
+    }
+
+    static constexpr auto idle_interval = std::chrono::milliseconds(1);
+
+    inline static std::atomic<std::uint64_t> next_id_{0};
+
+    Handler handler_;
+    Flusher flusher_;
+    std::atomic<std::size_t> capacity_;
+    const std::uint64_t id_ = ++next_id_;
+
+    std::mutex producers_mutex_;
+    std::vector<std::shared_ptr<RingBuffer<T>>> producers_;
+    std::vector<T> batch_;
+    std::atomic<std::size_t> peak_depth_{0};
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_;
+    std::uint64_t flush_requested_ = 0;
+    std::uint64_t flush_done_ = 0;
+    std::uint64_t durable_requested_ = 0; // 最近一次 durable flush 的票号
+    std::vector<std::pair<std::uint64_t, Callback>> callbacks_; // flush_async 的票号和回调
+    std::vector<Callback> ready_;                               // 后台线程专用
+    bool wake_ = false;
+    std::atomic<bool> nudged_{false};   // 生产者遇到队列满, 见 nudge
+    std::atomic<bool> sleeping_{false}; // 后台线程正在等待
+
+    std::jthread worker_; // 最后声明, 保证其余成员先构造后析构
+};
+
+// co_await 的 flush (见 Backend::flush_async). 完成后在后台线程上调用 resume(handle), 由它把协程投递回所在的执行器;
+// 不在后台线程上直接恢复, 协程之后的代码可以照常写日志和 flush
+template <typename T, typename Resume>
+    requires std::invocable<Resume &, std::coroutine_handle<>>
+class FlushAwaiter {
+public:
+    FlushAwaiter(Backend<T> &backend, Resume resume, bool durable = false)
+    : backend_(backend),
+      resume_(std::move(resume)),
+      durable_(durable) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    // 协程可能在 flush_async 返回前就已在后台线程恢复, 之后不再访问 this
+    void await_suspend(std::coroutine_handle<> handle) {
+        backend_.flush_async(
+            [resume = std::move(resume_), handle]() mutable {
+                resume(handle);
+            },
+            durable_);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    Backend<T> &backend_;
+    Resume resume_;
+    bool durable_;
+};
+} // namespace huxint
\ No newline at end of file
@@ -0,0 +1,260 @@
+#pragma once
+#if defined(__unix__) || defined(__APPLE__)
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "binlog.hpp"
+#include "codec.hpp"
+#include "record.hpp"
+#include "sink.hpp"
+
+namespace huxint {
+struct BinaryFileOptions {
+    std::size_t reserve = 64 << 20; // 每次预分配并映射的文件增量
+};
+
+// 二进制文件输出: 记录按 binlog.hpp 的格式追加到预分配的内存映射文件中, 不做文本格式化.
+// logger 名, 格式串, 文件名只在首次出现时写进字典, 之后每条记录只带 id. 用 huxint-logdecode 转回文本
+class BinaryFileSink final : public Sink {
+public:
+    explicit BinaryFileSink(const std::string &filename, BinaryFileOptions options = {})
+    : options_(options) {
+        fd_ = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open log file: " + filename);
+        }
+        struct stat st{};
+        ::fstat(fd_, &st);
+        const auto existing = static_cast<std::size_t>(st.st_size);
+        if (!map(std::max(existing, options_.reserve))) {
+            ::close(fd_);
+            throw std::runtime_error("Failed to map log file: " + filename);
+        }
+        if (existing == 0) {
+            std::memcpy(base_, binlog::magic.data(), binlog::magic.size());
+            used_ = binlog::magic.size();
+            return;
+        }
+        // 续写已有文件: 恢复字典并定位到最后一个完整块之后
+        const auto end = binlog::parse(
+            std::span<const std::byte>(base_, existing),
+            [this](std::uint32_t id, std::string_view text) {
+                remember(id, text);
+            },
+            [](const binlog::Entry &) {});
+        if (!end) {
+            ::munmap(base_, capacity_);
+            ::close(fd_);
+            throw std::runtime_error("Not a binary log file: " + filename);
+        }
+        used_ = *end;
+        std::memset(base_ + used_, 0, existing - used_); // 清掉崩溃时写了一半的块
+    }
+
+    BinaryFileSink(const BinaryFileSink &) = delete;
+    BinaryFileSink &operator=(const BinaryFileSink &) = delete;
+
+    ~BinaryFileSink() override {
+        ::munmap(base_, capacity_);
+        ::ftruncate(fd_, static_cast<off_t>(used_)); // 去掉预分配未用的部分
+        ::close(fd_);
+    }
+
+    void write(const Record &record) override {
+        write_batch({&record, 1});
+    }
+
+    void write_batch(std::span<const Record> records) override {
+        std::scoped_lock lock(mutex_);
+        for (const auto &record : records) {
+            append(record);
+        }
+    }
+
+    // 映射区已在页缓存中, 其他进程可见; 这里只发起异步回写
+    void flush() override {
+        std::scoped_lock lock(mutex_);
+        ::msync(base_, used_, MS_ASYNC);
+    }
+
+    void sync() override {
+        std::scoped_lock lock(mutex_);
+        ::msync(base_, used_, MS_SYNC);
+    }
+
+    // 不加锁, 不扩容, 只引用已在字典中的字符串. 映射为 MAP_SHARED, 写入即进入页缓存, 进程崩溃后仍会落盘
+    bool crash_write(const Record &record) override {
+        const auto name = find(record.name);
+        const auto file = find(record.file);
+        const auto format = find(record.format.empty() ? "{}" : record.format);
+        // 已格式化的消息之后仍接着上下文字段的编码 (见 Record::args)
+        const auto args_size = (record.format.empty() ? StringCodec::size(record.msg) : 0) + record.args.size();
+        if (!name || !file || !format || base_ == nullptr || used_ + binlog::record_header + args_size > capacity_) {
+            return false;
+        }
+        auto *out = base_ + used_;
+        put_header(out, record, *name, *format, *file, args_size);
+        if (record.format.empty()) {
+            StringCodec::encode(out, record.msg);
+        }
+        if (!record.args.empty()) {
+            std::memcpy(out, record.args.data(), record.args.size());
+        }
+        used_ += binlog::record_header + args_size;
+        return true;
+    }
+
+    bool needs_text() const override {
+        return false;
+    }
+
+    // 已写入的字节数 (含文件头和字典)
+    std::size_t size() const {
+        std::scoped_lock lock(mutex_);
+        return used_;
+    }
+
+private:
+    void append(const Record &record) {
+        const auto name = intern(record.name);
+        const auto file = intern(record.file);
+        std::uint32_t format = 0;
+        std::span<const std::byte> args = record.args;
+        if (record.format.empty()) {
+            // 已在调用线程格式化的消息按 "{}" 加一个字符串参数保存, 之后接着上下文字段
+            format = intern("{}");
+            scratch_.resize(StringCodec::size(record.msg) + record.args.size());
+            auto *out = scratch_.data();
+            StringCodec::encode(out, record.msg);
+            if (!record.args.empty()) {
+                std::memcpy(out, record.args.data(), record.args.size());
+            }
+            args = scratch_;
+        } else {
+            format = intern(record.format);
+        }
+        auto *out = reserve(binlog::record_header + args.size());
+        if (out == nullptr) {
+            return;
+        }
+        put_header(out, record, name, format, file, args.size());
+        std::memcpy(out, args.data(), args.size());
+        used_ += binlog::record_header + args.size();
+    }
+
+    static void put_header(std::byte *&out,
+                           const Record &record,
+                           std::uint32_t name,
+                           std::uint32_t format,
+                           std::uint32_t file,
+                           std::size_t args_size) {
+        detail::put(out, binlog::Chunk::Record);
+        detail::put(out, record.level);
+        detail::put(out, name);
+        detail::put(out, format);
+        detail::put(out, file);
+        detail::put(out, record.line);
+        detail::put(out, record.thread);
+        detail::put(out, static_cast<std::int64_t>(
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(record.time.time_since_epoch()).count()));
+        detail::put(out, static_cast<std::uint32_t>(args_size));
+    }
+
+    // 只查不写的 intern, 供崩溃处理使用
+    std::optional<std::uint32_t> find(std::string_view text) const {
+        if (const auto it = by_content_.find(text); it != by_content_.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    // 字符串多为静态存储, 先按地址查, 命中后核对内容; 再按内容查, 都没有时写出新的字典项
+    std::uint32_t intern(std::string_view text) {
+        if (const auto it = by_pointer_.find(text.data()); it != by_pointer_.end() && strings_[it->second] == text) {
+            return it->second;
+        }
+        std::uint32_t id = 0;
+        if (const auto it = by_content_.find(text); it != by_content_.end()) {
+            id = it->second;
+        } else {
+            auto *out = reserve(binlog::string_header + text.size());
+            if (out == nullptr) {
+                return 0;
+            }
+            id = static_cast<std::uint32_t>(strings_.size());
+            remember(id, text);
+            detail::put(out, binlog::Chunk::String);
+            detail::put(out, id);
+            detail::put(out, static_cast<std::uint32_t>(text.size()));
+            std::memcpy(out, text.data(), text.size());
+            used_ += binlog::string_header + text.size();
+        }
+        by_pointer_[text.data()] = id;
+        return id;
+    }
+
+    void remember(std::uint32_t id, std::string_view text) {
+        if (id >= strings_.size()) {
+            strings_.resize(id + 1);
+        }
+        strings_[id] = text;
+        by_content_[strings_[id]] = id; // deque 不移动元素, 作为键的 string_view 一直有效
+    }
+
+    // 返回可写入 n 字节的位置, 空间不够时扩大文件并重新映射. 磁盘满等失败时返回 nullptr, 本条丢弃
+    std::byte *reserve(std::size_t n) {
+        if (used_ + n > capacity_) {
+            const auto old = capacity_;
+            ::munmap(base_, capacity_);
+            if (!map(std::max(capacity_ + options_.reserve, used_ + n))) {
+                if (!map(old)) {
+                    base_ = nullptr; // 下次写入时再尝试映射
+                    capacity_ = 0;
+                }
+                return nullptr;
+            }
+        }
+        return base_ + used_;
+    }
+
+    bool map(std::size_t capacity) {
+        if (::ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+            return false;
+        }
+        void *p = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        base_ = static_cast<std::byte *>(p);
+        capacity_ = capacity;
+        return true;
+    }
+
+    BinaryFileOptions options_;
+    int fd_ = -1;
+    std::byte *base_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t used_ = 0;
+    std::deque<std::string> strings_; // 按 id 索引的字典
+    std::unordered_map<std::string_view, std::uint32_t> by_content_;
+    std::unordered_map<const char *, std::uint32_t> by_pointer_;
+    std::vector<std::byte> scratch_;
+    mutable std::mutex mutex_;
+};
+} // namespace huxint
+#endif
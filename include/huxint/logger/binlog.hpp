@@ -0,0 +1,147 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "codec.hpp"
+#include "level.hpp"
+#include "record.hpp"
+
+// 二进制日志文件格式 (BinaryFileSink 写, huxint-logdecode 读):
+//   文件头: magic (8 字节)
+//   之后是若干块, 每块以 1 字节类型开头, 类型 0 表示结束 (预分配未写的区域全为 0):
+//     String: u32 id, u32 长度, 内容                      字典项, 在首次被引用之前写出
+//     Record: u8 级别, u32 logger 名 id, u32 格式串 id, u32 文件名 id, u32 行号, u32 线程编号,
+//             i64 时间 (纳秒), u32 参数长度, 带类型标签的参数 (见 codec.hpp)
+//   整数均为本机字节序
+namespace huxint::binlog {
+inline constexpr std::string_view magic = "HXBLOG1\n";
+
+enum class Chunk : std::uint8_t { End, String, Record };
+
+inline constexpr std::size_t string_header = 1 + 2 * sizeof(std::uint32_t);
+inline constexpr std::size_t record_header = 2 + 6 * sizeof(std::uint32_t) + sizeof(std::int64_t);
+
+// 解析出的一条记录, 字符串均为字典 id
+struct Entry {
+    Level level;
+    std::uint32_t name;
+    std::uint32_t format;
+    std::uint32_t file;
+    std::uint32_t line;
+    std::uint32_t thread;
+    std::int64_t time; // 纳秒
+    std::span<const std::byte> args;
+};
+
+// 逐块解析 data (含文件头), 字典项交给 on_string(id, text), 记录交给 on_record(entry).
+// 返回最后一个完整块之后的偏移, 文件头不对时返回空
+template <typename S, typename R>
+std::optional<std::size_t> parse(std::span<const std::byte> data, S &&on_string, R &&on_record) {
+    if (data.size() < magic.size() || std::memcmp(data.data(), magic.data(), magic.size()) != 0) {
+        return std::nullopt;
+    }
+    const auto *begin = data.data();
+    const auto *in = begin + magic.size();
+    const auto *end = begin + data.size();
+    auto has = [&](std::size_t n) {
+        return static_cast<std::size_t>(end - in) >= n;
+    };
+    while (has(1)) {
+        const auto *chunk = in;
+        const auto type = detail::get<Chunk>(in);
+        if (type == Chunk::String && has(string_header - 1)) {
+            const auto id = detail::get<std::uint32_t>(in);
+            const auto n = detail::get<std::uint32_t>(in);
+            if (has(n)) {
+                on_string(id, std::string_view(reinterpret_cast<const char *>(in), n));
+                in += n;
+                continue;
+            }
+        } else if (type == Chunk::Record && has(record_header - 1)) {
+            Entry entry{};
+            entry.level = detail::get<Level>(in);
+            entry.name = detail::get<std::uint32_t>(in);
+            entry.format = detail::get<std::uint32_t>(in);
+            entry.file = detail::get<std::uint32_t>(in);
+            entry.line = detail::get<std::uint32_t>(in);
+            entry.thread = detail::get<std::uint32_t>(in);
+            entry.time = detail::get<std::int64_t>(in);
+            const auto n = detail::get<std::uint32_t>(in);
+            if (has(n)) {
+                entry.args = {in, n};
+                in += n;
+                on_record(entry);
+                continue;
+            }
+        }
+        // 结束标记, 或写到一半的块 (进程崩溃时)
+        return static_cast<std::size_t>(chunk - begin);
+    }
+    return static_cast<std::size_t>(in - begin);
+}
+
+struct Filter {
+    Level level = Level::Trace;
+    std::optional<std::string> logger;
+    std::chrono::system_clock::time_point since = std::chrono::system_clock::time_point::min();
+    std::chrono::system_clock::time_point until = std::chrono::system_clock::time_point::max();
+};
+
+// 解码为与文本 sink 相同的 Record 交给 fn(const Record &), msg 已格式化. 文件头不对时返回 false
+template <typename F>
+bool decode(std::span<const std::byte> data, const Filter &filter, F &&fn) {
+    std::vector<std::string_view> strings;
+    std::string msg;
+    auto text = [&](std::uint32_t id) {
+        return id < strings.size() ? strings[id] : std::string_view{};
+    };
+    return parse(
+               data,
+               [&](std::uint32_t id, std::string_view s) {
+                   if (id >= strings.size()) {
+                       strings.resize(id + 1);
+                   }
+                   strings[id] = s;
+               },
+               [&](const Entry &entry) {
+                   const std::chrono::system_clock::time_point time{
+                       std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                           std::chrono::nanoseconds(entry.time))};
+                   if (entry.level < filter.level || time < filter.since || time > filter.until ||
+                       (filter.logger && *filter.logger != text(entry.name))) {
+                       return;
+                   }
+                   const auto format = text(entry.format);
+                   msg.clear();
+                   try {
+                       format_tagged(msg, format, entry.args);
+                   } catch (const std::format_error &e) {
+                       msg = std::format("<format error: {}> {}", e.what(), format);
+                   }
+                   std::uint16_t fields = 0;
+                   visit_tagged(entry.args, [&](std::string_view key, const TaggedArg &) {
+                       if (!key.empty()) {
+                           ++fields;
+                       }
+                   });
+                   fn(Record{entry.level,
+                             text(entry.name),
+                             msg,
+                             text(entry.file),
+                             entry.line,
+                             time,
+                             entry.thread,
+                             format,
+                             entry.args,
+                             fields});
+               })
+        .has_value();
+}
+} // namespace huxint::binlog
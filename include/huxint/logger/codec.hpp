@@ -0,0 +1,556 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+// 参数二进制编码: 调用线程只拷贝参数, 后台线程再解码并格式化
+namespace huxint {
+// 类型标签, 每个参数前写一个字节, 使编码自描述
+// Key 不是独立的参数, 而是紧随其后的一个参数的字段名 (见 kv)
+enum class ArgType : std::uint8_t { Bool, Char, Int32, Int64, UInt32, UInt64, Float, Double, String, SysTime, Key };
+
+namespace detail {
+template <typename T>
+void put(std::byte *&out, const T &value) {
+    std::memcpy(out, &value, sizeof(T));
+    out += sizeof(T);
+}
+
+template <typename T>
+T get(const std::byte *&in) {
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+consteval std::uint8_t digits_of(std::intmax_t den) {
+    std::uint8_t n = 0;
+    for (; den > 1; den /= 10) {
+        ++n;
+    }
+    return n;
+}
+} // namespace detail
+
+// 单个类型的编解码, 未特化的类型不能延迟格式化
+template <typename T>
+struct ArgCodec {
+    static constexpr bool value = false;
+};
+
+template <>
+struct ArgCodec<bool> {
+    static constexpr bool value = true;
+    using decoded_type = bool;
+
+    static constexpr std::size_t size(bool) {
+        return 2;
+    }
+
+    static void encode(std::byte *&out, bool v) {
+        detail::put(out, ArgType::Bool);
+        detail::put(out, v);
+    }
+
+    static bool decode(const std::byte *&in) {
+        in += 1;
+        return detail::get<bool>(in);
+    }
+};
+
+template <>
+struct ArgCodec<char> {
+    static constexpr bool value = true;
+    using decoded_type = char;
+
+    static constexpr std::size_t size(char) {
+        return 2;
+    }
+
+    static void encode(std::byte *&out, char v) {
+        detail::put(out, ArgType::Char);
+        detail::put(out, v);
+    }
+
+    static char decode(const std::byte *&in) {
+        in += 1;
+        return detail::get<char>(in);
+    }
+};
+
+// 整数按有无符号和宽度归入四种标签, 解码时还原成原类型
+template <typename T>
+    requires(std::integral<T> && !std::same_as<T, bool> && !std::same_as<T, char>)
+struct ArgCodec<T> {
+    static constexpr bool value = true;
+    using decoded_type = T;
+    using wide_type = std::conditional_t<std::is_signed_v<T>,
+                                         std::conditional_t<(sizeof(T) <= 4), std::int32_t, std::int64_t>,
+                                         std::conditional_t<(sizeof(T) <= 4), std::uint32_t, std::uint64_t>>;
+    static constexpr ArgType tag = std::is_signed_v<T> ? (sizeof(T) <= 4 ? ArgType::Int32 : ArgType::Int64)
+                                                       : (sizeof(T) <= 4 ? ArgType::UInt32 : ArgType::UInt64);
+
+    static constexpr std::size_t size(T) {
+        return 1 + sizeof(wide_type);
+    }
+
+    static void encode(std::byte *&out, T v) {
+        detail::put(out, tag);
+        detail::put(out, static_cast<wide_type>(v));
+    }
+
+    static T decode(const std::byte *&in) {
+        in += 1;
+        return static_cast<T>(detail::get<wide_type>(in));
+    }
+};
+
+template <typename T>
+    requires(std::same_as<T, float> || std::same_as<T, double>)
+struct ArgCodec<T> {
+    static constexpr bool value = true;
+    using decoded_type = T;
+
+    static constexpr std::size_t size(T) {
+        return 1 + sizeof(T);
+    }
+
+    static void encode(std::byte *&out, T v) {
+        detail::put(out, std::same_as<T, float> ? ArgType::Float : ArgType::Double);
+        detail::put(out, v);
+    }
+
+    static T decode(const std::byte *&in) {
+        in += 1;
+        return detail::get<T>(in);
+    }
+};
+
+// 字符串内容直接拷贝进缓冲区, 解码为指向缓冲区的 string_view
+struct StringCodec {
+    static constexpr bool value = true;
+    using decoded_type = std::string_view;
+
+    static std::size_t size(std::string_view v) {
+        return 1 + sizeof(std::uint32_t) + v.size();
+    }
+
+    static void encode(std::byte *&out, std::string_view v) {
+        detail::put(out, ArgType::String);
+        detail::put(out, static_cast<std::uint32_t>(v.size()));
+        std::memcpy(out, v.data(), v.size());
+        out += v.size();
+    }
+
+    static std::string_view decode(const std::byte *&in) {
+        in += 1;
+        const auto n = detail::get<std::uint32_t>(in);
+        std::string_view v(reinterpret_cast<const char *>(in), n);
+        in += n;
+        return v;
+    }
+};
+
+template <>
+struct ArgCodec<const char *> : StringCodec {};
+
+template <>
+struct ArgCodec<char *> : StringCodec {};
+
+template <std::size_t N>
+struct ArgCodec<char[N]> : StringCodec {};
+
+template <>
+struct ArgCodec<std::string> : StringCodec {};
+
+template <>
+struct ArgCodec<std::string_view> : StringCodec {};
+
+// system_clock 时间点, 仅支持整数计数且精度为 10 的幂次分之一秒
+template <typename Duration>
+    requires(std::integral<typename Duration::rep> && Duration::period::num == 1 &&
+             (Duration::period::den == 1 || Duration::period::den == 1000 || Duration::period::den == 1000000 ||
+              Duration::period::den == 1000000000))
+struct ArgCodec<std::chrono::time_point<std::chrono::system_clock, Duration>> {
+    using time_point = std::chrono::time_point<std::chrono::system_clock, Duration>;
+    static constexpr bool value = true;
+    using decoded_type = time_point;
+
+    static constexpr std::size_t size(const time_point &) {
+        return 2 + sizeof(std::int64_t);
+    }
+
+    static void encode(std::byte *&out, const time_point &v) {
+        detail::put(out, ArgType::SysTime);
+        detail::put(out, detail::digits_of(Duration::period::den));
+        detail::put(out, static_cast<std::int64_t>(v.time_since_epoch().count()));
+    }
+
+    static time_point decode(const std::byte *&in) {
+        in += 2;
+        return time_point{Duration{static_cast<typename Duration::rep>(detail::get<std::int64_t>(in))}};
+    }
+};
+
+template <typename T>
+using arg_codec = ArgCodec<std::remove_cvref_t<T>>;
+
+// 结构化字段, 由 kv() 构造. 按参数编码随记录入队, 不在调用线程转成字符串, 由 sink 从 Record::args 中取出.
+// 格式串中的 {} 只输出值
+template <typename T>
+struct KeyValue {
+    std::string_view key; // 最长 255 字节, 超出部分截断
+    T value;
+};
+
+// 值只引用调用处的参数, 只能直接作为日志调用的实参
+template <typename T>
+    requires(arg_codec<T>::value)
+constexpr KeyValue<const T &> kv(std::string_view key, const T &value) {
+    return {key, value};
+}
+
+template <typename T>
+struct ArgCodec<KeyValue<T>> {
+    static constexpr bool value = arg_codec<T>::value;
+    using decoded_type = KeyValue<typename arg_codec<T>::decoded_type>;
+
+    static std::size_t size(const KeyValue<T> &v) {
+        return 2 + key_size(v.key) + arg_codec<T>::size(v.value);
+    }
+
+    static void encode(std::byte *&out, const KeyValue<T> &v) {
+        const auto n = key_size(v.key);
+        detail::put(out, ArgType::Key);
+        detail::put(out, static_cast<std::uint8_t>(n));
+        std::memcpy(out, v.key.data(), n);
+        out += n;
+        arg_codec<T>::encode(out, v.value);
+    }
+
+    static decoded_type decode(const std::byte *&in) {
+        in += 1;
+        const auto n = detail::get<std::uint8_t>(in);
+        std::string_view key(reinterpret_cast<const char *>(in), n);
+        in += n;
+        return {key, arg_codec<T>::decode(in)};
+    }
+
+private:
+    static std::size_t key_size(std::string_view key) {
+        return std::min<std::size_t>(key.size(), UINT8_MAX);
+    }
+};
+
+namespace detail {
+template <typename T>
+struct is_key_value : std::false_type {};
+
+template <typename T>
+struct is_key_value<KeyValue<T>> : std::true_type {};
+} // namespace detail
+
+// 全部参数都可编码时才走延迟格式化, 否则在调用线程直接格式化
+template <typename... Args>
+concept Deferrable = (arg_codec<Args>::value && ...);
+
+// 参数中 kv() 字段的个数
+template <typename... Args>
+inline constexpr std::size_t field_count =
+    (std::size_t{0} + ... + detail::is_key_value<std::remove_cvref_t<Args>>::value);
+
+template <typename... Args>
+concept HasFields = field_count<Args...> != 0;
+
+template <typename... Args>
+    requires Deferrable<Args...>
+std::size_t encoded_size(const Args &...args) {
+    return (std::size_t{0} + ... + arg_codec<Args>::size(args));
+}
+
+// 返回编码结束位置
+template <typename... Args>
+    requires Deferrable<Args...>
+std::byte *encode_args([[maybe_unused]] std::byte *out, const Args &...args) {
+    (arg_codec<Args>::encode(out, args), ...);
+    return out;
+}
+
+// 解码函数, 由 Args 在编译期生成, 随记录一起入队
+using DecodeFn = void (*)(std::string &out, std::string_view fmt, const std::byte *args);
+
+template <typename... Args>
+    requires Deferrable<Args...>
+void decode_args(std::string &out, std::string_view fmt, [[maybe_unused]] const std::byte *in) {
+    // 花括号初始化保证从左到右求值
+    std::tuple<typename arg_codec<Args>::decoded_type...> values{arg_codec<Args>::decode(in)...};
+    std::apply(
+        [&](auto &...vs) {
+            std::vformat_to(std::back_inserter(out), fmt, std::make_format_args(vs...));
+        },
+        values);
+}
+
+// 写入定长缓冲区的解码函数, 超出部分截断, 返回写入的长度. 不分配内存, 供崩溃处理使用
+using DecodeToFn = std::size_t (*)(std::span<char> out, std::string_view fmt, const std::byte *args);
+
+namespace detail {
+// 写满即停的输出迭代器
+struct BoundedOut {
+    using difference_type = std::ptrdiff_t;
+
+    char *pos;
+    char *end;
+
+    BoundedOut &operator=(char c) {
+        if (pos != end) {
+            *pos = c;
+        }
+        return *this;
+    }
+
+    BoundedOut &operator*() {
+        return *this;
+    }
+
+    BoundedOut &operator++() {
+        if (pos != end) {
+            ++pos;
+        }
+        return *this;
+    }
+
+    BoundedOut operator++(int) {
+        auto old = *this;
+        ++*this;
+        return old;
+    }
+};
+} // namespace detail
+
+template <typename... Args>
+    requires Deferrable<Args...>
+std::size_t decode_args_to(std::span<char> out, std::string_view fmt, [[maybe_unused]] const std::byte *in) {
+    std::tuple<typename arg_codec<Args>::decoded_type...> values{arg_codec<Args>::decode(in)...};
+    return std::apply(
+        [&](auto &...vs) {
+            const auto end = std::vformat_to(detail::BoundedOut{out.data(), out.data() + out.size()},
+                                              fmt,
+                                              std::make_format_args(vs...));
+            return static_cast<std::size_t>(end.pos - out.data());
+        },
+        values);
+}
+
+// 按类型标签解码出的参数, 用于离线解码等不知道原始类型的场合
+using TaggedArg = std::variant<bool,
+                               char,
+                               std::int32_t,
+                               std::int64_t,
+                               std::uint32_t,
+                               std::uint64_t,
+                               float,
+                               double,
+                               std::string_view,
+                               std::chrono::sys_seconds,
+                               std::chrono::sys_time<std::chrono::milliseconds>,
+                               std::chrono::sys_time<std::chrono::microseconds>,
+                               std::chrono::sys_time<std::chrono::nanoseconds>>;
+
+// 按标签逐个解码交给 fn(std::string_view key, const TaggedArg &), 不是 kv() 字段时 key 为空.
+// 不分配内存, 字符串指向 data. 数据不完整或标签未知时返回 false
+template <typename F>
+bool visit_tagged(std::span<const std::byte> data, F &&fn) {
+    const auto *in = data.data();
+    const auto *end = in + data.size();
+    auto has = [&](std::size_t n) {
+        return static_cast<std::size_t>(end - in) >= n;
+    };
+    while (in != end) {
+        auto tag = static_cast<ArgType>(*in++);
+        std::string_view key;
+        if (tag == ArgType::Key) {
+            if (!has(1)) {
+                return false;
+            }
+            const auto n = detail::get<std::uint8_t>(in);
+            if (!has(n + std::size_t{1})) {
+                return false;
+            }
+            key = {reinterpret_cast<const char *>(in), n};
+            in += n;
+            tag = static_cast<ArgType>(*in++);
+        }
+        switch (tag) {
+            case ArgType::Bool:
+                if (!has(sizeof(bool))) {
+                    return false;
+                }
+                fn(key, TaggedArg(detail::get<bool>(in)));
+                break;
+            case ArgType::Char:
+                if (!has(sizeof(char))) {
+                    return false;
+                }
+                fn(key, TaggedArg(detail::get<char>(in)));
+                break;
+            case ArgType::Int32:
+                if (!has(sizeof(std::int32_t))) {
+                    return false;
+                }
+                fn(key, TaggedArg(detail::get<std::int32_t>(in)));
+                break;
+            case ArgType::Int64:
+                if (!has(sizeof(std::int64_t))) {
+                    return false;
+                }
+                fn(key, TaggedArg(detail::get<std::int64_t>(in)));
+                break;
+            case ArgType::UInt32:
+                if (!has(sizeof(std::uint32_t))) {
+                    return false;
+                }
+                fn(key, TaggedArg(detail::get<std::uint32_t>(in)));
+                break;
+            case ArgType::UInt64:
+                if (!has(sizeof(std::uint64_t))) {
+                    return false;
+                }
+                fn(key, TaggedArg(detail::get<std::uint64_t>(in)));
+                break;
+            case ArgType::Float:
+                if (!has(sizeof(float))) {
+                    return false;
+                }
+                fn(key, TaggedArg(detail::get<float>(in)));
+                break;
+            case ArgType::Double:
+                if (!has(sizeof(double))) {
+                    return false;
+                }
+                fn(key, TaggedArg(detail::get<double>(in)));
+                break;
+            case ArgType::String: {
+                if (!has(sizeof(std::uint32_t))) {
+                    return false;
+                }
+                const auto n = detail::get<std::uint32_t>(in);
+                if (!has(n)) {
+                    return false;
+                }
+                fn(key, TaggedArg(std::string_view(reinterpret_cast<const char *>(in), n)));
+                in += n;
+                break;
+            }
+            case ArgType::SysTime: {
+                if (!has(1 + sizeof(std::int64_t))) {
+                    return false;
+                }
+                const auto digits = detail::get<std::uint8_t>(in);
+                const auto count = detail::get<std::int64_t>(in);
+                using namespace std::chrono;
+                switch (digits) {
+                    case 0:
+                        fn(key, TaggedArg(sys_seconds(seconds(count))));
+                        break;
+                    case 3:
+                        fn(key, TaggedArg(sys_time<milliseconds>(milliseconds(count))));
+                        break;
+                    case 6:
+                        fn(key, TaggedArg(sys_time<microseconds>(microseconds(count))));
+                        break;
+                    case 9:
+                        fn(key, TaggedArg(sys_time<nanoseconds>(nanoseconds(count))));
+                        break;
+                    default:
+                        return false;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// 全部参数按顺序放进 out, kv() 字段只取值
+inline bool decode_tagged(std::span<const std::byte> data, std::vector<TaggedArg> &out) {
+    return visit_tagged(data, [&](std::string_view, const TaggedArg &value) {
+        out.push_back(value);
+    });
+}
+
+// 运行期按格式串格式化带标签的参数, 结果与编译期类型已知时一致.
+// 支持 {} {:spec} {n} {n:spec} 以及 {{ }}, 不支持嵌套的动态宽度/精度. 出错时抛出 std::format_error
+inline void format_tagged(std::string &out, std::string_view fmt, std::span<const std::byte> data) {
+    std::vector<TaggedArg> values;
+    if (!decode_tagged(data, values)) {
+        throw std::format_error("malformed encoded arguments");
+    }
+    std::string spec;
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < fmt.size(); ++i) {
+        const char c = fmt[i];
+        if ((c == '{' || c == '}') && i + 1 < fmt.size() && fmt[i + 1] == c) {
+            out.push_back(c);
+            ++i;
+            continue;
+        }
+        if (c == '}') {
+            throw std::format_error("unmatched '}' in format string");
+        }
+        if (c != '{') {
+            out.push_back(c);
+            continue;
+        }
+        const auto close = fmt.find('}', i);
+        if (close == std::string_view::npos) {
+            throw std::format_error("unmatched '{' in format string");
+        }
+        const auto field = fmt.substr(i + 1, close - i - 1);
+        const auto colon = std::min(field.find(':'), field.size());
+        auto index = next++;
+        if (colon != 0) {
+            const auto [end, ec] = std::from_chars(field.data(), field.data() + colon, index);
+            if (ec != std::errc{} || end != field.data() + colon) {
+                throw std::format_error("invalid argument index in format string");
+            }
+        }
+        if (index >= values.size()) {
+            throw std::format_error("argument index out of range");
+        }
+        spec.assign("{");
+        spec.append(field.substr(colon));
+        spec.push_back('}');
+        std::visit(
+            [&](const auto &value) {
+                std::vformat_to(std::back_inserter(out), spec, std::make_format_args(value));
+            },
+            values[index]);
+        i = close;
+    }
+}
+} // namespace huxint
+
+// kv() 字段在格式串中只输出值
+template <typename T>
+struct std::formatter<huxint::KeyValue<T>> : std::formatter<std::remove_cvref_t<T>> {
+    auto format(const huxint::KeyValue<T> &field, std::format_context &ctx) const {
+        return std::formatter<std::remove_cvref_t<T>>::format(field.value, ctx);
+    }
+};
@@ -0,0 +1,198 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifdef HUXINT_LOG_ZLIB
+#include <zlib.h>
+#endif
+
+// 已轮转日志文件的压缩. 定义 HUXINT_LOG_ZLIB 并链接 zlib 时输出 gzip, 否则使用内置的简单 LZ77 分块格式 (.hlz)
+namespace huxint::lz {
+inline constexpr std::size_t block_size = 1 << 20;
+inline constexpr std::size_t min_match = 4;
+inline constexpr std::string_view magic = "HLZ1";
+
+namespace detail {
+inline void put_varint(std::string &out, std::size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline bool get_varint(const unsigned char *&in, const unsigned char *end, std::size_t &value) {
+    value = 0;
+    for (int shift = 0; in != end && shift < 64; shift += 7) {
+        const auto byte = *in++;
+        value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline std::uint32_t read32(const unsigned char *p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+} // namespace detail
+
+// 压缩一块: 若干个 (字面量长度, 字面量, 回溯距离, 匹配长度 - min_match) 序列, 以一段字面量结尾
+inline void compress_block(std::string_view input, std::string &out) {
+    constexpr std::size_t hash_bits = 14;
+    std::vector<std::uint32_t> table(std::size_t{1} << hash_bits, 0); // 位置 + 1, 0 表示空
+    const auto *in = reinterpret_cast<const unsigned char *>(input.data());
+    const auto n = input.size();
+    std::size_t anchor = 0;
+    std::size_t i = 0;
+    while (i + min_match <= n) {
+        const auto h = (detail::read32(in + i) * 2654435761u) >> (32 - hash_bits);
+        const auto candidate = table[h];
+        table[h] = static_cast<std::uint32_t>(i + 1);
+        if (candidate == 0 || detail::read32(in + candidate - 1) != detail::read32(in + i)) {
+            ++i;
+            continue;
+        }
+        const auto from = candidate - 1;
+        auto length = min_match;
+        while (i + length < n && in[from + length] == in[i + length]) {
+            ++length;
+        }
+        detail::put_varint(out, i - anchor);
+        out.append(input.substr(anchor, i - anchor));
+        detail::put_varint(out, i - from);
+        detail::put_varint(out, length - min_match);
+        i += length;
+        anchor = i;
+    }
+    detail::put_varint(out, n - anchor);
+    out.append(input.substr(anchor));
+}
+
+// 解压一块, raw_size 为原始长度. 数据损坏时返回 false
+inline bool decompress_block(std::string_view input, std::size_t raw_size, std::string &out) {
+    const auto *in = reinterpret_cast<const unsigned char *>(input.data());
+    const auto *end = in + input.size();
+    const auto start = out.size();
+    while (true) {
+        std::size_t literals = 0;
+        if (!detail::get_varint(in, end, literals) || literals > static_cast<std::size_t>(end - in)) {
+            return false;
+        }
+        out.append(reinterpret_cast<const char *>(in), literals);
+        in += literals;
+        if (out.size() - start >= raw_size) {
+            return out.size() - start == raw_size;
+        }
+        std::size_t offset = 0;
+        std::size_t length = 0;
+        if (!detail::get_varint(in, end, offset) || !detail::get_varint(in, end, length) || offset == 0 ||
+            offset > out.size() - start) {
+            return false;
+        }
+        length += min_match;
+        // 可能与输出重叠, 逐字节复制
+        for (auto from = out.size() - offset; length != 0; --length) {
+            out.push_back(out[from++]);
+        }
+    }
+}
+
+// 文件格式: magic, 之后每块为 varint 原始长度, varint 压缩长度, 压缩数据
+inline bool compress_file(const std::string &src, const std::string &dst) {
+    std::ifstream in(src, std::ios::binary);
+    std::ofstream out(dst, std::ios::binary | std::ios::trunc);
+    if (!in || !out) {
+        return false;
+    }
+    out.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+    std::string raw(block_size, '\0');
+    std::string block;
+    std::string header;
+    while (in) {
+        in.read(raw.data(), static_cast<std::streamsize>(raw.size()));
+        const auto n = static_cast<std::size_t>(in.gcount());
+        if (n == 0) {
+            break;
+        }
+        block.clear();
+        compress_block({raw.data(), n}, block);
+        header.clear();
+        detail::put_varint(header, n);
+        detail::put_varint(header, block.size());
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+    return static_cast<bool>(out.flush());
+}
+
+inline bool decompress_file(const std::string &src, const std::string &dst) {
+    std::ifstream in(src, std::ios::binary);
+    const std::string data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    if (!std::string_view(data).starts_with(magic)) {
+        return false;
+    }
+    std::ofstream out(dst, std::ios::binary | std::ios::trunc);
+    const auto *p = reinterpret_cast<const unsigned char *>(data.data()) + magic.size();
+    const auto *end = reinterpret_cast<const unsigned char *>(data.data()) + data.size();
+    std::string raw;
+    while (p != end) {
+        std::size_t raw_size = 0;
+        std::size_t size = 0;
+        if (!detail::get_varint(p, end, raw_size) || !detail::get_varint(p, end, size) ||
+            size > static_cast<std::size_t>(end - p)) {
+            return false;
+        }
+        raw.clear();
+        if (!decompress_block({reinterpret_cast<const char *>(p), size}, raw_size, raw)) {
+            return false;
+        }
+        out.write(raw.data(), static_cast<std::streamsize>(raw.size()));
+        p += size;
+    }
+    return static_cast<bool>(out.flush());
+}
+
+#ifdef HUXINT_LOG_ZLIB
+inline constexpr std::string_view extension = ".gz";
+
+inline bool compress_file_gzip(const std::string &src, const std::string &dst) {
+    std::ifstream in(src, std::ios::binary);
+    gzFile out = gzopen(dst.c_str(), "wb6");
+    if (!in || out == nullptr) {
+        if (out != nullptr) {
+            gzclose(out);
+        }
+        return false;
+    }
+    std::array<char, 64 * 1024> buffer;
+    bool ok = true;
+    while (ok && in) {
+        in.read(buffer.data(), buffer.size());
+        const auto n = static_cast<unsigned>(in.gcount());
+        ok = n == 0 || gzwrite(out, buffer.data(), n) == static_cast<int>(n);
+    }
+    return gzclose(out) == Z_OK && ok;
+}
+#else
+inline constexpr std::string_view extension = ".hlz";
+#endif
+
+// 按编译配置选择压缩格式, 输出文件名为 src + extension
+inline bool compress(const std::string &src) {
+#ifdef HUXINT_LOG_ZLIB
+    return compress_file_gzip(src, src + std::string(extension));
+#else
+    return compress_file(src, src + std::string(extension));
+#endif
+}
+} // namespace huxint::lz
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "codec.hpp"
+
+// 按线程的上下文字段 (MDC): log_context("req", id) 返回的守卫存在期间, 本线程写的每条日志都带上这个字段.
+// 字段在构造守卫时按 kv() 的方式编码一次, 每次调用只把编码后的字节拷进队列槽位, 不格式化;
+// 与 kv() 字段一样由 layout 的 {fields} 或 JsonSink 在后台线程输出
+namespace huxint {
+namespace detail {
+// 本线程当前的上下文字段, 各字段的编码依次排列
+struct ContextStack {
+    std::vector<std::byte> bytes;
+    std::uint16_t fields = 0;
+};
+
+inline ContextStack &context_stack() {
+    thread_local ContextStack stack;
+    return stack;
+}
+} // namespace detail
+
+// 作用域守卫, 析构时移除自己的字段. 必须按构造的相反顺序析构 (通常就是局部变量), 不可拷贝或移动
+class [[nodiscard]] ContextGuard {
+public:
+    template <typename T>
+        requires(arg_codec<T>::value)
+    ContextGuard(std::string_view key, const T &value) {
+        auto &stack = detail::context_stack();
+        const auto field = kv(key, value);
+        begin_ = stack.bytes.size();
+        stack.bytes.resize(begin_ + encoded_size(field));
+        encode_args(stack.bytes.data() + begin_, field);
+        ++stack.fields;
+    }
+
+    ContextGuard(const ContextGuard &) = delete;
+    ContextGuard &operator=(const ContextGuard &) = delete;
+
+    ~ContextGuard() {
+        auto &stack = detail::context_stack();
+        stack.bytes.resize(begin_);
+        --stack.fields;
+    }
+
+private:
+    std::size_t begin_ = 0;
+};
+
+// auto guard = log_context("req", id); 值的类型与 kv() 相同, 字符串会被拷贝
+template <typename T>
+    requires(arg_codec<T>::value)
+ContextGuard log_context(std::string_view key, const T &value) {
+    return {key, value};
+}
+} // namespace huxint
@@ -0,0 +1,165 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <span>
+#include <string_view>
+#include "record.hpp"
+#include "timestamp.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <io.h>
+#endif
+
+// 崩溃处理: 致命信号或 std::terminate 时, 由崩溃线程直接取空各 Logger 的队列写给 sink.
+// 处理过程不加锁, 不分配内存, 只用 write(2) 等系统调用; 属于尽力而为, 不保证与后台线程的输出互不交错
+namespace huxint {
+// 崩溃时需要抢救的对象, 由 LoggerState 实现
+class CrashTarget {
+public:
+    // 在信号处理函数或 terminate 处理函数中调用. 不支持崩溃写入的 sink 改写到 fd
+    virtual void salvage(int fd) noexcept = 0;
+
+protected:
+    ~CrashTarget() = default;
+};
+
+struct CrashOptions {
+    int fd = 2;             // 不支持崩溃写入的 sink (如基于 ofstream 的 FileSink) 改写到这里, 默认 stderr
+    bool terminate = true;  // 同时接管 std::terminate
+};
+
+namespace detail {
+inline constexpr std::size_t max_crash_targets = 256;
+
+// 固定大小的注册表, 信号处理函数中只做原子读
+inline std::array<std::atomic<CrashTarget *>, max_crash_targets> crash_targets{};
+inline std::atomic<int> crash_fd{2};
+inline std::atomic<bool> crashing{false};
+inline std::terminate_handler previous_terminate = nullptr;
+
+// 超过上限的 Logger 不参与崩溃抢救
+inline void register_crash_target(CrashTarget *target) {
+    for (auto &slot : crash_targets) {
+        CrashTarget *empty = nullptr;
+        if (slot.compare_exchange_strong(empty, target, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+}
+
+inline void unregister_crash_target(CrashTarget *target) {
+    for (auto &slot : crash_targets) {
+        auto *expected = target;
+        if (slot.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+}
+
+inline void write_fd(int fd, std::string_view text) {
+#if defined(__unix__) || defined(__APPLE__)
+    while (!text.empty()) {
+        const auto n = ::write(fd, text.data(), text.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        text.remove_prefix(static_cast<std::size_t>(n));
+    }
+#elif defined(_WIN32)
+    ::_write(fd, text.data(), static_cast<unsigned>(text.size()));
+#endif
+}
+
+// 按布局渲染一行到定长缓冲区, 放不下时截断消息
+template <typename P>
+std::string_view render_bounded(std::span<char> buffer,
+                                Record record,
+                                const P &layout,
+                                TimestampCache &timestamp,
+                                bool color) {
+    const auto other = layout.bound(record) - record.msg.size();
+    if (other + 1 > buffer.size()) {
+        return {};
+    }
+    record.msg = record.msg.substr(0, std::min(record.msg.size(), buffer.size() - other - 1));
+    auto *out = buffer.data();
+    layout.render(out, record, timestamp, color);
+    *out++ = '\n';
+    return {buffer.data(), static_cast<std::size_t>(out - buffer.data())};
+}
+
+// 只抢救一次: terminate 之后的 abort, 或抢救过程中再次崩溃时直接跳过
+inline void salvage_all(std::string_view reason) {
+    if (crashing.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    const auto fd = crash_fd.load(std::memory_order_relaxed);
+    write_fd(fd, reason);
+    for (auto &slot : crash_targets) {
+        if (auto *target = slot.load(std::memory_order_acquire)) {
+            target->salvage(fd);
+        }
+    }
+}
+
+inline void on_fatal_signal(int sig) {
+    char text[] = "huxint: fatal signal 00, writing queued logs\n";
+    text[21] = static_cast<char>('0' + sig / 10 % 10);
+    text[22] = static_cast<char>('0' + sig % 10);
+    salvage_all({text, sizeof(text) - 1});
+    // 恢复默认处理后重新触发, 保留原本的退出状态和 core dump
+    std::signal(sig, SIG_DFL);
+    std::raise(sig);
+}
+
+inline void on_terminate() {
+    salvage_all("huxint: std::terminate called, writing queued logs\n");
+    if (previous_terminate != nullptr) {
+        previous_terminate();
+    }
+    std::abort();
+}
+} // namespace detail
+
+// 安装崩溃处理 (可选, 进程内调用一次即可): SIGSEGV/SIGBUS/SIGFPE/SIGILL/SIGABRT 和 std::terminate 时
+// 把各 Logger 队列中尚未写出的日志直接写给 sink, 再按原本的方式结束进程.
+// 已被后台线程取走, 仍在 sink 自身缓冲中的内容不在此列; Fatal 日志需要确保落盘时配合 set_fatal_write_through
+inline void install_crash_handler(CrashOptions options = {}) {
+    detail::crash_fd.store(options.fd, std::memory_order_relaxed);
+#if defined(__unix__) || defined(__APPLE__)
+    // 栈溢出时原栈已不可用, 为安装线程准备备用栈
+    static char alt_stack[64 * 1024];
+    stack_t stack{};
+    stack.ss_sp = alt_stack;
+    stack.ss_size = sizeof(alt_stack);
+    ::sigaltstack(&stack, nullptr);
+    for (const int sig : {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT}) {
+        struct sigaction action{};
+        action.sa_handler = detail::on_fatal_signal;
+        action.sa_flags = SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        ::sigaction(sig, &action, nullptr);
+    }
+#else
+    for (const int sig : {SIGSEGV, SIGFPE, SIGILL, SIGABRT}) {
+        std::signal(sig, detail::on_fatal_signal);
+    }
+#endif
+    if (options.terminate) {
+        const auto previous = std::set_terminate(detail::on_terminate);
+        if (previous != detail::on_terminate) {
+            detail::previous_terminate = previous;
+        }
+    }
+}
+} // namespace huxint
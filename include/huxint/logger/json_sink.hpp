@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include "codec.hpp"
+#include "level.hpp"
+#include "record.hpp"
+#include "sink.hpp"
+#include "timestamp.hpp"
+
+namespace huxint {
+namespace json {
+// s 中第一个需要转义的字符 ('"', '\\' 和 0x00~0x1f) 的位置, 没有时返回 s.size().
+// 8 字节一组 (SWAR) 判断, 整组都不需要转义时一次跳过
+inline std::size_t clean_prefix(std::string_view s) {
+    constexpr std::uint64_t ones = 0x0101010101010101;
+    constexpr std::uint64_t highs = 0x8080808080808080;
+    auto zero_byte = [](std::uint64_t v) {
+        return (v - ones) & ~v & highs;
+    };
+    std::size_t i = 0;
+    for (; i + 8 <= s.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, s.data() + i, sizeof(word));
+        const auto control = (word - ones * 0x20) & ~word & highs;
+        if ((control | zero_byte(word ^ (ones * '"')) | zero_byte(word ^ (ones * '\\'))) != 0) {
+            break; // 组内逐字节定位
+        }
+    }
+    for (; i < s.size(); ++i) {
+        const auto c = static_cast<unsigned char>(s[i]);
+        if (c < 0x20 || c == '"' || c == '\\') {
+            return i;
+        }
+    }
+    return i;
+}
+
+// 追加带引号的 JSON 字符串. 不需要转义的连续片段整段拷贝, 非 ASCII 字节原样输出 (按 UTF-8 处理)
+inline void put_string(std::string &out, std::string_view s) {
+    out.push_back('"');
+    while (!s.empty()) {
+        const auto n = clean_prefix(s);
+        out.append(s.data(), n);
+        if (n == s.size()) {
+            break;
+        }
+        const char c = s[n];
+        switch (c) {
+            case '"':
+                out.append("\\\"");
+                break;
+            case '\\':
+                out.append("\\\\");
+                break;
+            case '\n':
+                out.append("\\n");
+                break;
+            case '\r':
+                out.append("\\r");
+                break;
+            case '\t':
+                out.append("\\t");
+                break;
+            case '\b':
+                out.append("\\b");
+                break;
+            case '\f':
+                out.append("\\f");
+                break;
+            default: {
+                constexpr std::string_view hex = "0123456789abcdef";
+                const auto u = static_cast<unsigned char>(c);
+                const char escaped[] = {'\\', 'u', '0', '0', hex[u >> 4], hex[u & 0xf]};
+                out.append(escaped, sizeof(escaped));
+                break;
+            }
+        }
+        s.remove_prefix(n + 1);
+    }
+    out.push_back('"');
+}
+
+template <typename T>
+void put_number(std::string &out, T value) {
+    if constexpr (std::is_floating_point_v<T>) {
+        if (!std::isfinite(value)) {
+            out.append("null"); // JSON 没有 NaN 和无穷
+            return;
+        }
+    }
+    char digits[32];
+    const auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end);
+}
+
+// 按解码出的类型直接写进 out: 数值和布尔不加引号, 时间为 ISO 8601 UTC 字符串
+inline void put_value(std::string &out, const TaggedArg &value) {
+    std::visit(
+        [&]<typename T>(const T &v) {
+            if constexpr (std::same_as<T, bool>) {
+                out.append(v ? "true" : "false");
+            } else if constexpr (std::same_as<T, char>) {
+                put_string(out, {&v, 1});
+            } else if constexpr (std::same_as<T, std::string_view>) {
+                put_string(out, v);
+            } else if constexpr (std::is_arithmetic_v<T>) {
+                put_number(out, v);
+            } else {
+                std::format_to(std::back_inserter(out), "\"{:%FT%TZ}\"", v);
+            }
+        },
+        value);
+}
+
+// JsonSink 自己输出的键, 同名的字段改写为 "fields.<key>", 避免同一对象中出现重复的键
+inline bool reserved_key(std::string_view key) {
+    constexpr std::string_view keys[] = {"time", "level", "logger", "file", "line", "thread", "msg"};
+    return std::ranges::find(keys, key) != std::end(keys);
+}
+} // namespace json
+
+// JSON Lines 输出: 每条记录一行 JSON 对象, kv() 字段展开为同级的键, 值保留原始类型. 例如
+// {"time":"2024-05-01T08:00:00.123456Z","level":"INFO","logger":"app","file":"main.cpp","line":12,"thread":1,
+//  "msg":"request done","latency_us":42,"user":"alice"}
+// name/file/line 为空时省略对应的键. 与这些内置键同名的字段改写为 "fields.<key>", 如 kv("msg", 1) 输出 "fields.msg":1
+class JsonSink final : public Sink {
+public:
+    explicit JsonSink(const std::string &filename, Precision precision = Precision::Micros)
+    : file_(filename, std::ios::app),
+      timestamp_(precision) {
+        if (!file_.is_open()) {
+            throw std::runtime_error("Failed to open log file: " + filename);
+        }
+    }
+
+    void write(const Record &record) override {
+        write_batch({&record, 1});
+    }
+
+    // 整批格式化到一块缓冲区后一次写出
+    void write_batch(std::span<const Record> records) override {
+        std::scoped_lock lock(mutex_);
+        buffer_.clear();
+        for (const auto &record : records) {
+            render(buffer_, record, timestamp_);
+            buffer_.push_back('\n');
+        }
+        file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    }
+
+    void flush() override {
+        std::scoped_lock lock(mutex_);
+        file_.flush();
+    }
+
+    // 一条记录的 JSON 对象, 不含换行
+    static void render(std::string &out, const Record &record, TimestampCache &timestamp) {
+        // 时间戳改写为 "YYYY-MM-DDTHH:MM:SS[.fff]Z"
+        out.append(R"({"time":")");
+        const auto time = out.size();
+        out.append(timestamp.format(record.time));
+        out[time + 10] = 'T';
+        out.append(R"(Z","level":")");
+        out.append(to_string(record.level));
+        out.push_back('"');
+        if (!record.name.empty()) {
+            out.append(R"(,"logger":)");
+            json::put_string(out, record.name);
+        }
+        if (!record.file.empty()) {
+            out.append(R"(,"file":)");
+            json::put_string(out, record.file);
+        }
+        if (record.line != 0) {
+            out.append(R"(,"line":)");
+            json::put_number(out, record.line);
+        }
+        out.append(R"(,"thread":)");
+        json::put_number(out, record.thread);
+        out.append(R"(,"msg":)");
+        json::put_string(out, record.msg);
+        if (record.fields != 0) {
+            visit_tagged(record.args, [&](std::string_view key, const TaggedArg &value) {
+                if (!key.empty()) {
+                    if (json::reserved_key(key)) {
+                        out.append(R"(,"fields.)"); // 内置键都不需要转义
+                        out.append(key);
+                        out.push_back('"');
+                    } else {
+                        out.push_back(',');
+                        json::put_string(out, key);
+                    }
+                    out.push_back(':');
+                    json::put_value(out, value);
+                }
+            });
+        }
+        out.push_back('}');
+    }
+
+private:
+    std::ofstream file_;
+    TimestampCache timestamp_;
+    std::string buffer_;
+    std::mutex mutex_;
+};
+} // namespace huxint
@@ -3,10 +3,18 @@
 #include <string_view>
 #include <utility>
 
+// 编译期最低级别 (0 = Trace ... 5 = Fatal), 低于它的调用在编译期被剔除. 可由 -DHUXINT_LOG_MIN_LEVEL=2 覆盖
+#ifndef HUXINT_LOG_MIN_LEVEL
+#define HUXINT_LOG_MIN_LEVEL 0
+#endif
+
 // 日志级别
 namespace huxint {
 enum class Level : std::uint8_t { Trace, Debug, Info, Warn, Error, Fatal };
 
+// Logger 第二个模板参数的默认值
+inline constexpr Level default_min_level = static_cast<Level>(HUXINT_LOG_MIN_LEVEL);
+
 constexpr std::string_view to_string(const Level level) noexcept {
     switch (level) {
         case Level::Trace:
@@ -0,0 +1,132 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include "codec.hpp"
+
+// 按调用处限流: 每个调用处持有一个静态的限流对象 (见 macros.hpp 中的 HUXINT_*_EVERY_N 等),
+// 在级别判断之后, 编码和格式化之前决定本次调用是否写出. 只用原子计数, 不加锁也不分配内存
+namespace huxint {
+// 一次判断的结果. suppressed 非 0 时先补写一条 summary, 内容为此前被拦下的条数
+struct SiteVerdict {
+    bool emit = true;
+    std::uint64_t suppressed = 0;
+};
+
+// 第 1, n + 1, 2n + 1 ... 次调用写出, 其余直接丢弃, 不补写汇总
+class EveryN {
+public:
+    static constexpr std::string_view summary = "";
+
+    explicit constexpr EveryN(std::uint64_t n)
+    : n_(n == 0 ? 1 : n) {}
+
+    template <typename... Args>
+    SiteVerdict check(const Args &...) {
+        return {count_.fetch_add(1, std::memory_order_relaxed) % n_ == 0, 0};
+    }
+
+private:
+    const std::uint64_t n_;
+    std::atomic<std::uint64_t> count_{0};
+};
+
+// 每个整秒 (steady_clock) 最多写出 n 次 (n 为 0 时全部拦下). 新的一秒第一次写出前补写上一段时间被拦下的条数
+class PerSecond {
+public:
+    static constexpr std::string_view summary = "{} similar messages suppressed";
+
+    explicit constexpr PerSecond(std::uint32_t n)
+    : n_(n) {}
+
+    template <typename... Args>
+    SiteVerdict check(const Args &...) {
+        const auto now = static_cast<std::uint32_t>(
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+        // 高 32 位为秒, 低 32 位为这一秒内已写出的次数
+        auto state = state_.load(std::memory_order_relaxed);
+        while (true) {
+            std::uint64_t next = 0;
+            if (state >> 32 != now && n_ != 0) {
+                next = std::uint64_t{now} << 32 | 1;
+            } else if ((state & UINT32_MAX) < n_) {
+                next = state + 1;
+            } else {
+                suppressed_.fetch_add(1, std::memory_order_relaxed);
+                return {false, 0};
+            }
+            if (state_.compare_exchange_weak(state, next, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        return {true, suppressed_.exchange(0, std::memory_order_relaxed)};
+    }
+
+private:
+    const std::uint32_t n_;
+    std::atomic<std::uint64_t> state_{0};
+    std::atomic<std::uint64_t> suppressed_{0};
+};
+
+// 吞掉与上一条参数完全相同的连续重复, 参数变化时先补写 "last message repeated K times".
+// 重复持续超过 interval 时也照常写出一条并补写次数, 避免长时间没有输出.
+// 参数按 codec.hpp 编码到栈上后比较哈希; 不可编码或编码超过 max_size 的调用不去重. 多线程同时写同一调用处时计数是近似的
+class Dedup {
+public:
+    static constexpr std::string_view summary = "last message repeated {} times";
+    static constexpr std::size_t max_size = 256;
+
+    explicit constexpr Dedup(std::chrono::milliseconds interval = std::chrono::seconds(1))
+    : interval_(interval.count()) {}
+
+    template <typename... Args>
+    SiteVerdict check(const Args &...args) {
+        std::uint64_t hash = 0;
+        if constexpr (Deferrable<Args...>) {
+            if (encoded_size(args...) <= max_size) {
+                std::array<std::byte, max_size> buffer;
+                const auto *end = encode_args(buffer.data(), args...);
+                hash = fnv1a({buffer.data(), end});
+            }
+        }
+        const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now().time_since_epoch())
+                             .count();
+        const auto last = last_.exchange(hash, std::memory_order_relaxed);
+        if (hash != 0 && last == hash && now - emitted_.load(std::memory_order_relaxed) < interval_) {
+            repeats_.fetch_add(1, std::memory_order_relaxed);
+            return {false, 0};
+        }
+        emitted_.store(now, std::memory_order_relaxed);
+        return {true, repeats_.exchange(0, std::memory_order_relaxed)};
+    }
+
+private:
+    // 0 留给 "不去重"
+    static std::uint64_t fnv1a(std::span<const std::byte> data) {
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (const auto b : data) {
+            hash = (hash ^ static_cast<std::uint64_t>(b)) * 1099511628211ULL;
+        }
+        return hash == 0 ? 1 : hash;
+    }
+
+    const std::int64_t interval_;
+    std::atomic<std::uint64_t> last_{0};
+    std::atomic<std::int64_t> emitted_{0};
+    std::atomic<std::uint64_t> repeats_{0};
+};
+
+// 可作为 Logger::info(site, ...) 等第一个参数的限流对象
+template <typename S>
+concept SiteLimiter = requires(S &site) {
+    { S::summary } -> std::convertible_to<std::string_view>;
+    { site.check() } -> std::same_as<SiteVerdict>;
+};
+} // namespace huxint
@@ -1,58 +1,1193 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <memory>
 #include <format>
 #include <vector>
+#include <span>
 #include <concepts>
+#include <iterator>
 #include "level.hpp"
+#include "record.hpp"
 #include "sink.hpp"
 #include "util.hpp"
-#include <huxint/thread_pool>
+#include "backend.hpp"
+#include "codec.hpp"
+#include "context.hpp"
+#include "crash.hpp"
+#include "limit.hpp"
+#include "metrics.hpp"
+#include "pattern.hpp"
+#include "worker.hpp"
+
+// 队列槽位中内联存放参数编码或消息文本的字节数, 不超过它的调用在稳定状态下不分配堆内存.
+// 每个生产者队列占用约 容量 x (inline_size + 120) 字节, 可由 -DHUXINT_LOG_INLINE_SIZE=512 调整
+#ifndef HUXINT_LOG_INLINE_SIZE
+#define HUXINT_LOG_INLINE_SIZE 160
+#endif
 
 namespace huxint {
-// Logger 状态
-struct LoggerState {
-    Level level = Level::Trace;
-    std::vector<std::unique_ptr<Sink>> sinks;
-    std::unique_ptr<ThreadPool<>> pool = std::make_unique<ThreadPool<>>(1);
+class LoggerState;
 
-    void flush() {
-        pool->wait();
-        for (const auto &sink : sinks) {
-            sink->flush();
+// 队列中的一条日志. 消息按 payload 存放: 参数编码在 args 中 (带 kv() 字段且超过 inline_size 时在 msg 中),
+// 由后台线程按需格式化到 LoggerState 的文本缓冲; 或者调用线程已格式化, 不超过 inline_size 的文本直接存在 args 中,
+// 更长的放在 msg. 调用线程的上下文字段 (见 context.hpp) 的编码接在这些字节之后, 占最后 context_size 字节
+struct LogEntry {
+    static constexpr std::size_t inline_size = HUXINT_LOG_INLINE_SIZE; // 参数编码超过此大小时回退到调用线程格式化
+    static_assert(inline_size <= UINT16_MAX);
+
+    enum class Payload : std::uint8_t {
+        Args,   // 参数编码, 见 encoded()
+        Inline, // args 中是文本
+        Heap,   // msg
+        Text,   // 已由后台线程格式化, 文本在 text 缓冲的 [text_offset, text_offset + text_size)
+    };
+
+    // 调用线程格式化好的文本, 构造时拷贝
+    struct Text {
+        std::string_view value;
+    };
+
+    static constexpr std::uint64_t all_sinks = ~std::uint64_t{0};
+
+    LoggerState *logger = nullptr; // 所属 logger, 后台线程据此分发
+    Level level{};
+    std::uint64_t sinks = all_sinks; // 第 i 位为 1 时交给所属 logger 的第 i 个 sink, 见 LoggerState::route
+    std::string_view name;
+    std::string_view file;
+    std::uint32_t line = 0;
+    std::chrono::system_clock::time_point time;
+    std::uint32_t thread = thread_id(); // 在生产者线程构造
+    std::string_view format;
+    DecodeFn decode = nullptr;
+    DecodeToFn decode_to = nullptr; // 崩溃处理中格式化到定长缓冲区
+    Payload payload = Payload::Heap;
+    std::uint16_t args_size = 0;
+    std::uint16_t fields = 0;       // 参数中 kv() 字段与上下文字段的个数
+    std::uint16_t context_size = 0; // 上下文字段的编码字节数
+    std::uint32_t text_offset = 0;
+    std::uint32_t text_size = 0;
+    std::string msg;
+    std::array<std::byte, inline_size> args;
+
+    LogEntry(LoggerState *logger,
+             Level level,
+             std::uint64_t sinks,
+             std::string_view name,
+             std::string_view file,
+             std::uint32_t line,
+             std::chrono::system_clock::time_point time,
+             std::string msg)
+    : logger(logger),
+      level(level),
+      sinks(sinks),
+      name(name),
+      file(file),
+      line(line),
+      time(time),
+      msg(std::move(msg)) {}
+
+    LogEntry(LoggerState *logger,
+             Level level,
+             std::uint64_t sinks,
+             std::string_view name,
+             std::string_view file,
+             std::uint32_t line,
+             std::chrono::system_clock::time_point time,
+             Text text)
+    : logger(logger),
+      level(level),
+      sinks(sinks),
+      name(name),
+      file(file),
+      line(line),
+      time(time) {
+        const auto &context = detail::context_stack();
+        const auto size = text.value.size() + context.bytes.size();
+        fields = context.fields;
+        context_size = static_cast<std::uint16_t>(context.bytes.size());
+        if (size <= inline_size) {
+            std::memcpy(args.data(), text.value.data(), text.value.size());
+            if (!context.bytes.empty()) {
+                std::memcpy(args.data() + text.value.size(), context.bytes.data(), context.bytes.size());
+            }
+            args_size = static_cast<std::uint16_t>(size);
+            payload = Payload::Inline;
+        } else {
+            msg.reserve(size);
+            msg.assign(text.value);
+            msg.append(reinterpret_cast<const char *>(context.bytes.data()), context.bytes.size());
+        }
+    }
+
+    template <typename... Args>
+        requires Deferrable<Args...>
+    LogEntry(LoggerState *logger,
+             Level level,
+             std::uint64_t sinks,
+             std::string_view name,
+             std::string_view file,
+             std::uint32_t line,
+             std::chrono::system_clock::time_point time,
+             std::string_view format,
+             const Args &...values)
+    : logger(logger),
+      level(level),
+      sinks(sinks),
+      name(name),
+      file(file),
+      line(line),
+      time(time),
+      format(format),
+      decode(&decode_args<Args...>),
+      decode_to(&decode_args_to<Args...>),
+      payload(Payload::Args),
+      fields(static_cast<std::uint16_t>(field_count<Args...>)) {
+        // 解码只读到本次调用的参数为止, 上下文字段只在 visit_tagged 时可见
+        const auto &context = detail::context_stack();
+        fields += context.fields;
+        context_size = static_cast<std::uint16_t>(context.bytes.size());
+        auto *out = args.data();
+        if (const auto size = encoded_size(values...) + context.bytes.size(); size > inline_size) {
+            msg.resize(size);
+            out = reinterpret_cast<std::byte *>(msg.data());
+        }
+        out = encode_args(out, values...);
+        if (!context.bytes.empty()) {
+            std::memcpy(out, context.bytes.data(), context.bytes.size());
+        }
+        if (msg.empty()) {
+            args_size = static_cast<std::uint16_t>(out - args.data() + context.bytes.size());
+        }
+    }
+
+    // 存放的全部字节: payload 为 Args 或 Text 时是参数编码, 否则是文本; 都以上下文字段的编码结尾
+    std::span<const std::byte> encoded() const {
+        if (!msg.empty()) {
+            return {reinterpret_cast<const std::byte *>(msg.data()), msg.size()};
+        }
+        return {args.data(), args_size};
+    }
+
+    // 后台线程调用, 把编码的参数格式化后追加到 text, 只格式化一次. text 在整批之间复用, 稳定后不再分配
+    void materialize(std::string &text) {
+        if (payload != Payload::Args) {
+            return;
+        }
+        const auto begin = text.size();
+        try {
+            decode(text, format, encoded().data());
+        } catch (const std::format_error &e) {
+            text.resize(begin);
+            std::format_to(std::back_inserter(text), "<format error: {}> {}", e.what(), format);
+        }
+        text_offset = static_cast<std::uint32_t>(begin);
+        text_size = static_cast<std::uint32_t>(text.size() - begin);
+        payload = Payload::Text;
+    }
+
+    // text 为 materialize 时使用的缓冲
+    Record record(std::string_view text = {}) const {
+        Record record{level, name, {}, file, line, time, thread};
+        record.fields = fields;
+        switch (payload) {
+            case Payload::Inline:
+            case Payload::Heap: {
+                // 文本之后只有上下文字段
+                const auto stored = encoded();
+                record.msg = {reinterpret_cast<const char *>(stored.data()), stored.size() - context_size};
+                record.args = stored.last(context_size);
+                return record;
+            }
+            case Payload::Text:
+                record.msg = text.substr(text_offset, text_size);
+                break;
+            case Payload::Args:
+                break;
+        }
+        record.format = format;
+        record.args = encoded();
+        return record;
+    }
+};
+
+namespace detail {
+// 一个线程在某个 logger 上最近被级别过滤掉的日志 (见 LoggerState::set_backtrace). 由该线程写入,
+// 只有 dump 时才有另一个线程来抢锁
+struct Backtrace {
+    std::mutex mutex;
+    std::vector<std::optional<LogEntry>> slots;
+    std::size_t next = 0; // 下一条写入的位置, 也是最旧的一条
+};
+} // namespace detail
+
+// 一个命名 logger 的运行期状态: 级别, 背压策略和 sink 列表. 由 Registry 创建并持有, 地址在进程内不变,
+// 可按名字查到后在运行期调整. 所有 logger 共用 Registry 的后台线程和每线程队列
+class LoggerState {
+public:
+    using Sinks = std::vector<std::shared_ptr<Sink>>;
+
+    LoggerState(std::string_view name, Backend<LogEntry> &backend)
+    : name_(name),
+      backend_(backend) {
+        history_.push_back(std::make_unique<const SinkList>());
+        sinks_.store(history_.back().get(), std::memory_order_release);
+        route_history_.push_back(std::make_unique<const Routes>());
+        routes_.store(route_history_.back().get(), std::memory_order_release);
+    }
+
+    LoggerState(const LoggerState &) = delete;
+    LoggerState &operator=(const LoggerState &) = delete;
+
+    std::string_view name() const {
+        return name_;
+    }
+
+    // 日志线程只做 relaxed 读, 与修改并发也无数据竞争
+    void level(const Level lv) {
+        std::scoped_lock lock(config_mutex_);
+        level_.store(lv, std::memory_order_relaxed);
+        refresh_threshold();
+    }
+
+    Level level() const {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    // 实际生效的级别: level() 与各 sink 级别中最低者的较大值, 低于它的调用没有 sink 会要, 只比较这一次即可返回
+    Level threshold() const {
+        return threshold_.load(std::memory_order_relaxed);
+    }
+
+    // 队列满时的处理方式, 只作用于 Warn 及以下级别, Error/Fatal 仍然阻塞等待
+    void set_overflow(const Overflow policy) {
+        for (auto lv : {Level::Trace, Level::Debug, Level::Info, Level::Warn}) {
+            set_overflow(lv, policy);
         }
     }
 
-    ~LoggerState() {
+    void set_overflow(const Level lv, const Overflow policy) {
+        overflow_[static_cast<std::size_t>(lv)].store(policy, std::memory_order_relaxed);
+    }
+
+    Overflow overflow(const Level lv) const {
+        return overflow_[static_cast<std::size_t>(lv)].load(std::memory_order_relaxed);
+    }
+
+    // 开启后 fatal 阻塞到本条及之前的日志都已写出并同步到持久存储 (Sink::sync), 默认关闭
+    void set_fatal_write_through(const bool enable) {
+        write_through_.store(enable, std::memory_order_relaxed);
+    }
+
+    bool fatal_write_through() const {
+        return write_through_.load(std::memory_order_relaxed);
+    }
+
+    template <typename T, typename... Args>
+        requires std::derived_from<T, Sink>
+    T *add_sink(Args &&...args) {
+        auto sink = std::make_shared<T>(std::forward<Args>(args)...);
+        auto *ptr = sink.get();
+        add_sink(std::move(sink));
+        return ptr;
+    }
+
+    // 同一个 sink 可以挂到多个 logger 上, 级别和过滤谓词只作用于本 logger. 两者都在调用线程入队前判断,
+    // 没有 sink 要的日志不格式化也不入队; 只有前 64 个 sink 可以筛选, 之后的收到全部日志
+    void add_sink(std::shared_ptr<Sink> sink, Level lv = Level::Trace, SinkFilter filter = {}) {
+        std::scoped_lock lock(config_mutex_);
+        auto next = std::make_unique<SinkList>(list());
+        next->sinks.push_back(std::move(sink));
+        next->counters.push_back(std::make_shared<detail::SinkCounters>());
+        history_.push_back(std::move(next));
+        sinks_.store(history_.back().get(), std::memory_order_release);
+        update_routes([&](Routes &routes) {
+            routes.levels.push_back(lv);
+            routes.filters.push_back(std::move(filter));
+        });
+    }
+
+    // 调整已挂上的 sink 在本 logger 上的级别或过滤谓词, sink 不在本 logger 上时不做任何事
+    void set_sink_level(const Sink *sink, const Level lv) {
+        std::scoped_lock lock(config_mutex_);
+        if (const auto i = index_of(sink); i < list().sinks.size()) {
+            update_routes([&](Routes &routes) {
+                routes.levels[i] = lv;
+            });
+        }
+    }
+
+    void set_sink_filter(const Sink *sink, SinkFilter filter) {
+        std::scoped_lock lock(config_mutex_);
+        if (const auto i = index_of(sink); i < list().sinks.size()) {
+            update_routes([&](Routes &routes) {
+                routes.filters[i] = std::move(filter);
+            });
+        }
+    }
+
+    // 移除全部 sink. 先换成空列表再 flush, 确认后台线程和工作线程都已不再使用旧列表后才释放
+    void clear_sinks() {
+        std::scoped_lock lock(config_mutex_);
+        history_.push_back(std::make_unique<const SinkList>());
+        sinks_.store(history_.back().get(), std::memory_order_release);
+        update_routes([](Routes &routes) {
+            routes = {};
+        });
         flush();
+        history_.erase(history_.begin(), history_.end() - 1);
     }
+
+    // 调用线程在入队前调用: 按各 sink 的级别和过滤谓词求出要这条日志的 sink, 见 LogEntry::sinks
+    std::uint64_t route(Level lv, std::string_view name, std::string_view file, std::uint32_t line) const {
+        const auto &routes = *routes_.load(std::memory_order_acquire);
+        if (!routes.selective) {
+            return LogEntry::all_sinks;
+        }
+        const SinkSite site{lv, name, file, line};
+        auto mask = LogEntry::all_sinks;
+        for (std::size_t i = 0; i < std::min<std::size_t>(routes.levels.size(), 64); ++i) {
+            if (lv < routes.levels[i] || (routes.filters[i] && !routes.filters[i](site))) {
+                mask &= ~(std::uint64_t{1} << i);
+            }
+        }
+        return mask;
+    }
+
+    // 当前 sink 列表. 修改时整体替换, 旧列表保留到下次 clear_sinks, 后台线程读取时不加锁
+    const Sinks &sinks() const {
+        return list().sinks;
+    }
+
+    // count > 1 时 sink 分到 count 个工作线程上并行写入, 每个 sink 仍按入队顺序收到记录.
+    // 新的工作线程交给后台线程在批次之间换上 (见 adopt_workers), 返回时已生效. 不能在后台线程上调用
+    void set_thread_count(std::size_t count) {
+        std::vector<std::unique_ptr<SinkWorker>> next;
+        for (std::size_t i = 0; count > 1 && i < count; ++i) {
+            next.push_back(std::make_unique<SinkWorker>());
+        }
+        {
+            std::scoped_lock lock(workers_mutex_);
+            pending_workers_ = std::move(next);
+            workers_pending_.store(true, std::memory_order_release);
+        }
+        flush();
+    }
+
+    // 因队列满被丢弃的日志条数
+    std::uint64_t dropped() const {
+        std::uint64_t total = 0;
+        for (const auto &count : dropped_) {
+            total += count.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // 开启后额外统计入队到写出的延迟和每个 sink 的 write/flush 耗时 (后台线程每批多读几次时钟), 默认关闭.
+    // 条数和队列深度始终统计
+    void set_metrics(const bool enable) {
+        timed_.store(enable, std::memory_order_relaxed);
+    }
+
+    // 当前指标的快照, 可在任意线程调用
+    LoggerMetrics metrics() {
+        LoggerMetrics metrics;
+        metrics.name = name_;
+        {
+            std::scoped_lock lock(counters_mutex_);
+            // 线程已退出 (只剩这里的引用) 的计数并入 retired_ 后回收
+            std::erase_if(thread_counters_, [this](const std::shared_ptr<detail::ThreadCounters> &counters) {
+                if (counters.use_count() != 1) {
+                    return false;
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                for (std::size_t lv = 0; lv < retired_.size(); ++lv) {
+                    retired_[lv] += counters->submitted[lv].get();
+                }
+                return true;
+            });
+            metrics.submitted = retired_;
+            for (const auto &counters : thread_counters_) {
+                for (std::size_t lv = 0; lv < retired_.size(); ++lv) {
+                    metrics.submitted[lv] += counters->submitted[lv].get();
+                }
+            }
+        }
+        for (std::size_t lv = 0; lv < dropped_.size(); ++lv) {
+            metrics.written[lv] = written_[lv].get();
+            metrics.dropped[lv] = dropped_[lv].load(std::memory_order_relaxed);
+        }
+        metrics.queue_depth = backend_.depth();
+        metrics.peak_queue_depth = backend_.peak_depth();
+        for (std::size_t i = 0; i < metrics.latency.counts.size(); ++i) {
+            metrics.latency.counts[i] = latency_[i].get();
+        }
+        for (const auto &counters : list().counters) {
+            metrics.sinks.push_back(counters->load());
+        }
+        return metrics;
+    }
+
+    // 每隔 interval 由后台线程向 sink 写一条 Info 级别的指标摘要 (见 LoggerMetrics::summary); sink 为空时停止.
+    // sink 不必挂在本 logger 上
+    void report_metrics(std::shared_ptr<Sink> sink, std::chrono::milliseconds interval) {
+        std::scoped_lock lock(report_mutex_);
+        report_sink_ = std::move(sink);
+        report_interval_ = report_sink_ ? interval : std::chrono::milliseconds::zero();
+        next_report_ = std::chrono::steady_clock::now() + report_interval_;
+    }
+
+    // n > 0 时低于当前级别的日志不丢弃, 按入队时的形式 (编码的参数, 不格式化) 存进每个线程最近 n 条的环形缓冲,
+    // 在本 logger 写 Error/Fatal 或调用 dump_backtrace() 时按时间顺序补写给 sink. n 为 0 时关闭. 修改时清空已存的记录
+    void set_backtrace(std::size_t n) {
+        std::scoped_lock lock(backtraces_mutex_);
+        backtrace_.store(n, std::memory_order_relaxed);
+        for (const auto &ring : backtraces_) {
+            std::scoped_lock ring_lock(ring->mutex);
+            ring->slots.clear();
+            ring->next = 0;
+        }
+    }
+
+    std::size_t backtrace() const {
+        return backtrace_.load(std::memory_order_relaxed);
+    }
+
+    // 生产者调用, 把一条被级别过滤掉的日志存进本线程的环形缓冲, 满时覆盖最旧的一条
+    template <typename... Args>
+    void remember(Level lv, Args &&...args) {
+        auto &ring = local_backtrace();
+        std::scoped_lock lock(ring.mutex);
+        const auto size = backtrace();
+        if (ring.slots.size() != size) {
+            ring.slots.clear();
+            ring.slots.resize(size);
+            ring.next = 0;
+        }
+        if (size == 0) {
+            return;
+        }
+        ring.slots[ring.next].emplace(this, lv, LogEntry::all_sinks, std::forward<Args>(args)...);
+        ring.next = (ring.next + 1) % size;
+    }
+
+    // 取空所有线程的环形缓冲, 按调用时间排序后从当前线程入队, 因此排在本线程随后写的日志之前.
+    // 仍按各 sink 的级别和过滤谓词筛选. 已退出线程的缓冲在这里回收
+    void dump_backtrace() {
+        std::vector<LogEntry> entries;
+        {
+            std::scoped_lock lock(backtraces_mutex_);
+            std::erase_if(backtraces_, [&entries](const std::shared_ptr<detail::Backtrace> &ring) {
+                const bool orphan = ring.use_count() == 1;
+                std::scoped_lock ring_lock(ring->mutex);
+                const auto size = ring->slots.size();
+                for (std::size_t i = 0; i < size; ++i) {
+                    if (auto &slot = ring->slots[(ring->next + i) % size]) {
+                        entries.push_back(std::move(*slot));
+                        slot.reset();
+                    }
+                }
+                return orphan;
+            });
+        }
+        std::ranges::stable_sort(entries, {}, &LogEntry::time);
+        for (auto &entry : entries) {
+            // 存入时还没有按 sink 筛选, 补写时只交给要它的 sink
+            entry.sinks = route(entry.level, entry.name, entry.file, entry.line);
+            if (entry.sinks == 0) {
+                continue;
+            }
+            local_counters().submitted[static_cast<std::size_t>(entry.level)].add();
+            backend_.push(Overflow::Block, &evict, std::move(entry)); // 补写的上下文不丢
+        }
+    }
+
+    // 共用后台线程, 会连同其他 logger 一起 flush
+    void flush() {
+        backend_.flush();
+    }
+
+    // 不阻塞, 调用前已入队的记录都交给 sink 并 flush 后在后台线程调用 done, 见 Backend::flush_async
+    void flush(std::function<void()> done) {
+        backend_.flush_async(std::move(done));
+    }
+
+    // co_await state.async_flush(resume); 见 FlushAwaiter
+    template <typename Resume>
+        requires std::invocable<Resume &, std::coroutine_handle<>>
+    FlushAwaiter<LogEntry, Resume> async_flush(Resume resume) {
+        return {backend_, std::move(resume)};
+    }
+
+    void sync() {
+        backend_.flush(true);
+    }
+
+    // 生产者调用. 被 DropOldest 覆盖的记录计入其所属的 logger
+    template <typename... Args>
+    void push(Overflow policy, Level lv, Args &&...args) {
+        local_counters().submitted[static_cast<std::size_t>(lv)].add();
+        const bool queued = backend_.push(policy, &evict, this, lv, std::forward<Args>(args)...);
+        if (!queued) {
+            dropped_[static_cast<std::size_t>(lv)].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 以下由后台线程调用
+
+    // 每条日志只生成一个 Record, 按 sink 分发, 同一 sink 内保持入队顺序
+    void dispatch(std::span<LogEntry> batch) {
+        adopt_workers();
+        // 只取一次 sink 列表: 判断是否格式化和分发用同一个版本, 中途换上的文本 sink 不会收到未格式化的记录
+        const auto &list = this->list();
+        // 全部 sink 都直接使用编码参数 (如 BinaryFileSink) 时跳过文本格式化
+        text_.clear();
+        if (std::ranges::any_of(list.sinks, &Sink::needs_text)) {
+            for (auto &entry : batch) {
+                entry.materialize(text_);
+            }
+        }
+        const bool timed = timed_.load(std::memory_order_relaxed);
+        deliver(list, batch, timed);
+        const auto now = timed ? std::chrono::system_clock::now() : std::chrono::system_clock::time_point{};
+        for (const auto &entry : batch) {
+            written_[static_cast<std::size_t>(entry.level)].add();
+            if (timed) {
+                latency_[LatencyHistogram::bucket(now - entry.time)].add();
+            }
+        }
+    }
+
+    // 丢弃总数在相邻两轮之间不再增长即视为压力解除, 补写一条汇总; flush 时无条件补写
+    void report_drops(bool force) {
+        const auto dropped = this->dropped();
+        if (dropped != reported_drops_ && (force || dropped == seen_drops_)) {
+            LogEntry entry{this,
+                           Level::Warn,
+                           LogEntry::all_sinks,
+                           name_,
+                           "",
+                           0,
+                           std::chrono::system_clock::now(),
+                           std::format("dropped {} records", dropped - reported_drops_)};
+            deliver(list(), {&entry, 1}, false);
+            reported_drops_ = dropped;
+        }
+        seen_drops_ = dropped;
+    }
+
+    // 到了 report_metrics 设定的时间时写一条指标摘要
+    void report_metrics() {
+        std::shared_ptr<Sink> sink;
+        {
+            std::scoped_lock lock(report_mutex_);
+            const auto now = std::chrono::steady_clock::now();
+            if (!report_sink_ || now < next_report_) {
+                return;
+            }
+            next_report_ = now + report_interval_;
+            sink = report_sink_;
+        }
+        const LogEntry entry{
+            this, Level::Info, LogEntry::all_sinks, name_, "", 0, std::chrono::system_clock::now(), metrics().summary()};
+        sink->write(entry.record());
+    }
+
+    void flush_sinks(bool durable) {
+        adopt_workers();
+        flush_job_ = {&list(), workers_.size(), durable, timed_.load(std::memory_order_relaxed)};
+        if (workers_.empty()) {
+            for (std::size_t i = 0; i < flush_job_.list->sinks.size(); ++i) {
+                flush_one(flush_job_, i);
+            }
+            return;
+        }
+        // 任务只捕获两个字, 装得进 std::function 的内部存储, 不分配
+        for_each_shard(flush_job_.list->sinks, [&](std::size_t shard) {
+            workers_[shard]->post([job = &flush_job_, shard] {
+                for (auto i = shard; i < job->list->sinks.size(); i += job->workers) {
+                    flush_one(*job, i);
+                }
+            });
+        });
+        for (const auto &worker : workers_) {
+            worker->wait();
+        }
+    }
+
+    // 崩溃线程调用 (见 Registry::salvage): 消息格式化到栈上的定长缓冲区, 不支持崩溃写入的 sink 改写到 fd
+    void salvage(const LogEntry &entry, int fd, TimestampCache &timestamp) noexcept {
+        char msg[1024];
+        char line[2048];
+        auto record = entry.record();
+        if (entry.payload == LogEntry::Payload::Args) {
+            try {
+                record.msg = {msg, entry.decode_to({msg, sizeof(msg)}, entry.format, entry.encoded().data())};
+            } catch (...) {
+                record.msg = entry.format;
+            }
+        }
+        // 与后台线程一样只写给要这条记录的 sink
+        bool fallback = false;
+        const auto &sinks = this->sinks();
+        for (std::size_t i = 0; i < sinks.size(); ++i) {
+            if (wants(entry, i)) {
+                fallback = !sinks[i]->crash_write(record) || fallback;
+            }
+        }
+        if (fallback) {
+            detail::write_fd(fd, detail::render_bounded(line, record, FilePattern{}, timestamp, false));
+        }
+    }
+
+private:
+    // sink 列表的一个版本. 每个 sink 的计数随 sink 沿用到之后的版本
+    struct SinkList {
+        Sinks sinks;
+        std::vector<std::shared_ptr<detail::SinkCounters>> counters;
+    };
+
+    const SinkList &list() const {
+        return *sinks_.load(std::memory_order_acquire);
+    }
+
+    // 交给 sink 工作线程的一批日志, 持有 Record 引用的字符串, 各工作线程共享. 由后台线程循环复用,
+    // pending 归零 (分到的工作线程都写完) 后才重新填充, 各缓冲的容量随之沿用
+    struct SharedBatch {
+        std::vector<LogEntry> entries;
+        std::string text;
+        std::vector<Record> records;
+        const SinkList *list = nullptr;
+        std::size_t workers = 0;
+        std::uint64_t common = 0; // 整批都要的 sink
+        bool timed = false;
+        std::atomic<std::size_t> pending{0};
+    };
+
+    // 一次 flush 分给各工作线程的参数, flush_sinks 等工作线程做完才返回, 可以复用
+    struct FlushJob {
+        const SinkList *list = nullptr;
+        std::size_t workers = 0;
+        bool durable = false;
+        bool timed = false;
+    };
+
+    // 各 sink 在本 logger 上的级别和过滤谓词, 与 SinkList 下标一致. 生产者不加锁读取, 旧版本不回收
+    struct Routes {
+        std::vector<Level> levels;
+        std::vector<SinkFilter> filters;
+        Level min_level = Level::Trace;
+        bool selective = false; // 存在高于 min_level 的 sink 或过滤谓词, 需要逐个判断
+    };
+
+    // 持有 config_mutex_ 时调用
+    template <typename F>
+    void update_routes(F &&fn) {
+        auto next = std::make_unique<Routes>(*routes_.load(std::memory_order_relaxed));
+        fn(*next);
+        next->min_level = next->levels.empty() ? Level::Trace : std::ranges::min(next->levels);
+        next->selective = std::ranges::any_of(next->levels,
+                                              [&](Level lv) {
+                                                  return lv != next->min_level;
+                                              }) ||
+                          std::ranges::any_of(next->filters, [](const SinkFilter &filter) {
+                              return static_cast<bool>(filter);
+                          });
+        route_history_.push_back(std::move(next));
+        routes_.store(route_history_.back().get(), std::memory_order_release);
+        refresh_threshold();
+    }
+
+    void refresh_threshold() {
+        const auto min_level = routes_.load(std::memory_order_relaxed)->min_level;
+        threshold_.store(std::max(level_.load(std::memory_order_relaxed), min_level), std::memory_order_relaxed);
+    }
+
+    std::size_t index_of(const Sink *sink) const {
+        const auto &sinks = list().sinks;
+        return static_cast<std::size_t>(std::ranges::find_if(sinks,
+                                                             [sink](const std::shared_ptr<Sink> &p) {
+                                                                 return p.get() == sink;
+                                                             }) -
+                                        sinks.begin());
+    }
+
+    // 第 i 个 sink 是否要这条记录
+    static bool wants(const LogEntry &entry, std::size_t i) {
+        return i >= 64 || (entry.sinks >> i & 1) != 0;
+    }
+
+    // 从整批记录中挑出第 i 个 sink 要的
+    static void select(std::span<const LogEntry> entries,
+                       std::span<const Record> records,
+                       std::size_t i,
+                       std::vector<Record> &out) {
+        out.clear();
+        for (std::size_t k = 0; k < entries.size(); ++k) {
+            if (wants(entries[k], i)) {
+                out.push_back(records[k]);
+            }
+        }
+    }
+
+    // 被 DropOldest 覆盖的记录
+    static void evict(LogEntry &victim) {
+        victim.logger->dropped_[static_cast<std::size_t>(victim.level)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point begin) {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+    }
+
+    // 当前线程在本 logger 上的提交计数, 首次使用时登记
+    detail::ThreadCounters &local_counters() {
+        thread_local std::vector<std::pair<const LoggerState *, std::shared_ptr<detail::ThreadCounters>>> cache;
+        for (auto &[owner, counters] : cache) {
+            if (owner == this) {
+                return *counters;
+            }
+        }
+        auto counters = std::make_shared<detail::ThreadCounters>();
+        {
+            std::scoped_lock lock(counters_mutex_);
+            thread_counters_.push_back(counters);
+        }
+        cache.emplace_back(this, counters);
+        return *counters;
+    }
+
+    // 当前线程在本 logger 上的 backtrace 环形缓冲, 首次使用时登记. 线程退出后由 dump_backtrace 回收
+    detail::Backtrace &local_backtrace() {
+        thread_local std::vector<std::pair<const LoggerState *, std::shared_ptr<detail::Backtrace>>> cache;
+        for (auto &[owner, ring] : cache) {
+            if (owner == this) {
+                return *ring;
+            }
+        }
+        auto ring = std::make_shared<detail::Backtrace>();
+        {
+            std::scoped_lock lock(backtraces_mutex_);
+            backtraces_.push_back(ring);
+        }
+        cache.emplace_back(this, ring);
+        return *ring;
+    }
+
+    static void flush_one(const FlushJob &job, std::size_t i) {
+        auto &counters = *job.list->counters[i];
+        counters.flushes.add();
+        const auto begin = job.timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+        if (job.durable) {
+            job.list->sinks[i]->sync();
+        } else {
+            job.list->sinks[i]->flush();
+        }
+        if (job.timed) {
+            counters.flush_ns.add(elapsed_ns(begin));
+        }
+    }
+
+    // 写第 i 个 sink 的线程 (后台线程或固定的工作线程) 调用
+    static void write_to(const SinkList &list, std::size_t i, std::span<const Record> records, bool timed) {
+        auto &counters = *list.counters[i];
+        counters.records.add(records.size());
+        counters.batches.add();
+        if (!timed) {
+            list.sinks[i]->write_batch(records);
+            return;
+        }
+        const auto begin = std::chrono::steady_clock::now();
+        list.sinks[i]->write_batch(records);
+        counters.write_ns.add(elapsed_ns(begin));
+    }
+
+    // 整批都要的 sink 直接拿整批记录, 其余的各自挑出一份
+    void deliver(const SinkList &list, std::span<LogEntry> batch, bool timed) {
+        auto common = LogEntry::all_sinks;
+        for (const auto &entry : batch) {
+            common &= entry.sinks;
+        }
+        if (workers_.empty()) {
+            records_.clear();
+            for (const auto &entry : batch) {
+                records_.push_back(entry.record(text_));
+            }
+            for (std::size_t i = 0; i < list.sinks.size(); ++i) {
+                if (i >= 64 || (common >> i & 1) != 0) {
+                    write_to(list, i, records_, timed);
+                    continue;
+                }
+                select(batch, records_, i, selected_);
+                if (!selected_.empty()) {
+                    write_to(list, i, selected_, timed);
+                }
+            }
+            return;
+        }
+        // 记录移入共享批次后再生成 Record, 之后后台线程即可继续取下一批
+        auto &shared = idle_batch();
+        shared.entries.clear();
+        shared.entries.insert(
+            shared.entries.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        shared.text.swap(text_); // 换回上一轮的缓冲, 文本缓冲的容量同样沿用
+        shared.records.clear();
+        for (const auto &entry : shared.entries) {
+            shared.records.push_back(entry.record(shared.text));
+        }
+        shared.list = &list;
+        shared.workers = workers_.size();
+        shared.common = common;
+        shared.timed = timed;
+        shared.pending.store(std::min(workers_.size(), list.sinks.size()), std::memory_order_relaxed);
+        // 任务只捕获两个字, 装得进 std::function 的内部存储, 不分配
+        for_each_shard(list.sinks, [&](std::size_t shard) {
+            workers_[shard]->post([batch = &shared, shard] {
+                thread_local std::vector<Record> selected; // 每个工作线程一份, 容量沿用
+                const auto &list = *batch->list;
+                for (auto i = shard; i < list.sinks.size(); i += batch->workers) {
+                    if (i >= 64 || (batch->common >> i & 1) != 0) {
+                        write_to(list, i, batch->records, batch->timed);
+                        continue;
+                    }
+                    select(batch->entries, batch->records, i, selected);
+                    if (!selected.empty()) {
+                        write_to(list, i, selected, batch->timed);
+                    }
+                }
+                batch->pending.fetch_sub(1, std::memory_order_release);
+            });
+        });
+    }
+
+    // 取一个工作线程都已写完的批次, 没有时新建. 个数以同时在途的批次为上限
+    SharedBatch &idle_batch() {
+        for (const auto &batch : batches_) {
+            if (batch->pending.load(std::memory_order_acquire) == 0) {
+                return *batch;
+            }
+        }
+        return *batches_.emplace_back(std::make_unique<SharedBatch>());
+    }
+
+    // 后台线程调用: 换上 set_thread_count 准备好的工作线程. 旧的工作线程先执行完已提交的任务再销毁,
+    // 工作线程的任务只捕获当时的线程数, 不读 workers_
+    void adopt_workers() {
+        if (!workers_pending_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::vector<std::unique_ptr<SinkWorker>> next;
+        {
+            std::scoped_lock lock(workers_mutex_);
+            next.swap(pending_workers_);
+            workers_pending_.store(false, std::memory_order_relaxed);
+        }
+        for (const auto &worker : workers_) {
+            worker->wait();
+        }
+        workers_.swap(next);
+    }
+
+    // 只遍历分到了 sink 的工作线程
+    template <typename F>
+    void for_each_shard(const Sinks &sinks, F &&fn) {
+        for (std::size_t shard = 0; shard < std::min(workers_.size(), sinks.size()); ++shard) {
+            fn(shard);
+        }
+    }
+
+    const std::string name_;
+    Backend<LogEntry> &backend_;
+    std::atomic<Level> level_{Level::Trace};
+    std::atomic<Level> threshold_{Level::Trace}; // 见 threshold()
+    std::array<std::atomic<Overflow>, 6> overflow_{}; // 按级别的队列满处理方式, 默认全部 Block
+    std::atomic<bool> write_through_{false};
+    std::array<std::atomic<std::uint64_t>, 6> dropped_{}; // 按级别, 生产者累加
+    std::uint64_t seen_drops_ = 0;     // 后台线程上一轮看到的丢弃总数
+    std::uint64_t reported_drops_ = 0; // 已写出汇总的丢弃总数
+    std::atomic<std::size_t> backtrace_{0}; // 每个线程暂存的条数, 0 为关闭
+    std::mutex backtraces_mutex_;
+    std::vector<std::shared_ptr<detail::Backtrace>> backtraces_;
+
+    // 指标. written_/latency_ 只由后台线程累加
+    std::atomic<bool> timed_{false};
+    std::array<detail::Counter, 6> written_;
+    std::array<detail::Counter, LatencyHistogram::buckets> latency_;
+    std::mutex counters_mutex_;
+    std::vector<std::shared_ptr<detail::ThreadCounters>> thread_counters_;
+    std::array<std::uint64_t, 6> retired_{}; // 已退出线程的提交数
+    std::mutex report_mutex_;
+    std::shared_ptr<Sink> report_sink_;
+    std::chrono::milliseconds report_interval_{};
+    std::chrono::steady_clock::time_point next_report_;
+
+    std::mutex config_mutex_;
+    std::atomic<const SinkList *> sinks_{nullptr};
+    std::vector<std::unique_ptr<const SinkList>> history_;
+    std::atomic<const Routes *> routes_{nullptr};
+    std::vector<std::unique_ptr<const Routes>> route_history_;
+    std::vector<std::unique_ptr<SharedBatch>> batches_; // 在 workers_ 之前声明, 工作线程先退出
+    FlushJob flush_job_;
+    std::vector<std::unique_ptr<SinkWorker>> workers_; // 第 i 个 sink 固定由 workers_[i % n] 写入, 为空时在后台线程直接写.
+                                                       // 只由后台线程读写
+    std::mutex workers_mutex_;
+    std::vector<std::unique_ptr<SinkWorker>> pending_workers_; // set_thread_count 准备好, 等后台线程换上
+    std::atomic<bool> workers_pending_{false};
+    std::vector<Record> records_;                      // 后台线程复用的记录缓冲
+    std::vector<Record> selected_;                     // 只要一部分记录的 sink 用, 同样复用
+    std::string text_;                                 // 后台线程复用的文本缓冲, 一批的消息依次格式化到这里
+};
+
+// 进程内所有 logger 的登记处: 按名字查找或创建, 全部共用一个后台线程和每线程队列.
+// 编译期的 Logger<"name"> 只是指向这里某个 LoggerState 的引用
+class Registry final : CrashTarget {
+public:
+    Registry() {
+        detail::register_crash_target(this);
+    }
+
+    Registry(const Registry &) = delete;
+    Registry &operator=(const Registry &) = delete;
+
+    ~Registry() {
+        detail::unregister_crash_target(this);
+    }
+
+    // 按名字取 logger, 不存在时创建. 返回的引用在进程内一直有效
+    LoggerState &get(std::string_view name) {
+        std::scoped_lock lock(mutex_);
+        if (const auto it = loggers_.find(name); it != loggers_.end()) {
+            return *it->second;
+        }
+        auto &state = loggers_[std::string(name)];
+        state = std::make_unique<LoggerState>(name, backend_);
+        list_.push_back(state.get());
+        return *state;
+    }
+
+    // 不存在时返回 nullptr
+    LoggerState *find(std::string_view name) {
+        std::scoped_lock lock(mutex_);
+        const auto it = loggers_.find(name);
+        return it == loggers_.end() ? nullptr : it->second.get();
+    }
+
+    // 依次访问当前所有 logger, 如重新加载配置时统一调整级别
+    template <typename F>
+    void for_each(F &&fn) {
+        for (auto *state : loggers()) {
+            fn(*state);
+        }
+    }
+
+    // 每个生产者线程的队列容量, 所有 logger 共用, 只影响之后首次写日志的线程
+    void set_queue_capacity(std::size_t capacity) {
+        backend_.capacity(capacity);
+    }
+
+    void flush() {
+        backend_.flush();
+    }
+
+    // 所有 logger 的指标快照
+    std::vector<LoggerMetrics> metrics() {
+        std::vector<LoggerMetrics> result;
+        for (auto *state : loggers()) {
+            result.push_back(state->metrics());
+        }
+        return result;
+    }
+
+private:
+    std::vector<LoggerState *> loggers() {
+        std::scoped_lock lock(mutex_);
+        return list_;
+    }
+
+    // 连续属于同一 logger 的记录一起交付, 各 logger 内保持入队顺序
+    void dispatch(std::span<LogEntry> batch) {
+        for (std::size_t begin = 0; begin < batch.size();) {
+            auto *state = batch[begin].logger;
+            auto end = begin + 1;
+            while (end < batch.size() && batch[end].logger == state) {
+                ++end;
+            }
+            state->dispatch(batch.subspan(begin, end - begin));
+            begin = end;
+        }
+        for_each_cached([](LoggerState &state) {
+            state.report_drops(false);
+            state.report_metrics();
+        });
+    }
+
+    // 后台线程遍历 logger 时复用同一个缓冲, 不在每批分配
+    template <typename F>
+    void for_each_cached(F &&fn) {
+        {
+            std::scoped_lock lock(mutex_);
+            cached_.assign(list_.begin(), list_.end());
+        }
+        for (auto *state : cached_) {
+            fn(*state);
+        }
+    }
+
+    // 崩溃线程调用: 后台线程可能已卡住, 直接取空各队列, 按记录所属的 logger 写给 sink
+    void salvage(int fd) noexcept override {
+        TimestampCache timestamp;
+        backend_.salvage([&](const LogEntry &entry) {
+            entry.logger->salvage(entry, fd, timestamp);
+        });
+    }
+
+    std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<LoggerState>, std::less<>> loggers_;
+    std::vector<LoggerState *> list_;   // 按创建顺序
+    std::vector<LoggerState *> cached_; // 后台线程专用
+    Backend<LogEntry> backend_{[this](std::span<LogEntry> batch) {
+                                   dispatch(batch);
+                               },
+                               [this](bool durable) {
+                                   for_each_cached([durable](LoggerState &state) {
+                                       state.report_drops(true);
+                                       state.flush_sinks(durable);
+                                   });
+                               },
+                               1024}; // 最后声明, 先停止后台线程再销毁各 logger
 };
 
-template <String Name = "">
+inline Registry &registry() {
+    static Registry instance;
+    return instance;
+}
+
+namespace detail {
+// 调用线程格式化消息的缓冲, 返回前清空. 偶尔的超长消息之后释放, 不长期占用
+inline std::string &format_buffer() {
+    constexpr std::size_t max_kept = 64 * 1024;
+    thread_local std::string buffer;
+    if (buffer.capacity() > max_kept) {
+        std::string().swap(buffer);
+    }
+    buffer.clear();
+    return buffer;
+}
+} // namespace detail
+
+// MinLevel 为编译期最低级别, 低于它的调用编译为空
+template <String Name = "", Level MinLevel = default_min_level>
 class Logger {
-    inline static LoggerState state_; // 封装, 方便析构
+    inline static LoggerState &state_ = registry().get(Name.str()); // 同名的运行期 logger 是同一个
 
 public:
+    // 运行期句柄, 与 registry().get(name()) 相同
+    static LoggerState &state() {
+        return state_;
+    }
+
+    static constexpr Level min_level() {
+        return MinLevel;
+    }
+
+    // 该级别当前是否会被记录 (或暂存进 backtrace), 宏前端据此决定是否对参数求值
+    static bool enabled(const Level lv) {
+        return lv >= MinLevel && (lv >= state_.threshold() || state_.backtrace() != 0);
+    }
+
     template <typename T, typename... Args>
         requires std::derived_from<T, Sink>
     static T *add_sink(Args &&...args) { // 添加返回 sink 指针, 方便自己配置
-        auto sink = std::make_unique<T>(std::forward<Args>(args)...);
-        auto *ptr = sink.get();
-        state_.sinks.push_back(std::move(sink));
-        return ptr;
+        return state_.template add_sink<T>(std::forward<Args>(args)...);
+    }
+
+    // 挂上已有的 sink, 可与其他 logger 共用
+    static void add_sink(std::shared_ptr<Sink> sink, Level lv = Level::Trace, SinkFilter filter = {}) {
+        state_.add_sink(std::move(sink), lv, std::move(filter));
+    }
+
+    // sink 在本 logger 上的最低级别和过滤谓词, 在调用线程入队前判断, 见 LoggerState::add_sink
+    static void set_sink_level(const Sink *sink, const Level lv) {
+        state_.set_sink_level(sink, lv);
+    }
+
+    static void set_sink_filter(const Sink *sink, SinkFilter filter) {
+        state_.set_sink_filter(sink, std::move(filter));
+    }
+
+    static void clear_sinks() {
+        state_.clear_sinks();
     }
 
     static void level(const Level lv) {
-        state_.level = lv;
+        state_.level(lv);
     }
 
     static Level level() {
-        return state_.level;
+        return state_.level();
+    }
+
+    // 队列满时的处理方式, 只作用于 Warn 及以下级别, Error/Fatal 仍然阻塞等待
+    static void set_overflow(const Overflow policy) {
+        state_.set_overflow(policy);
+    }
+
+    static void set_overflow(const Level lv, const Overflow policy) {
+        state_.set_overflow(lv, policy);
+    }
+
+    // 开启后 fatal 阻塞到本条及之前的日志都已写出并同步到持久存储 (Sink::sync), 默认关闭
+    static void set_fatal_write_through(const bool enable) {
+        state_.set_fatal_write_through(enable);
+    }
+
+    // 每个线程暂存最近 n 条低于当前级别的日志, 在 Error/Fatal 时补写, 见 LoggerState::set_backtrace
+    static void set_backtrace(std::size_t n) {
+        state_.set_backtrace(n);
+    }
+
+    static void dump_backtrace() {
+        state_.dump_backtrace();
     }
 
+    // 每个生产者线程的队列容量, 所有 logger 共用, 只影响之后首次写日志的线程
+    static void set_queue_capacity(std::size_t capacity) {
+        registry().set_queue_capacity(capacity);
+    }
+
+    // 因队列满被丢弃的日志条数
+    static std::uint64_t dropped() {
+        return state_.dropped();
+    }
+
+    // count > 1 时 sink 分到 count 个工作线程上并行写入, 每个 sink 仍按入队顺序收到记录
     static void set_thread_count(std::size_t count) {
-        state_.pool = std::make_unique<ThreadPool<>>(count);
+        state_.set_thread_count(count);
+    }
+
+    // 开启延迟和 sink 耗时统计, 见 LoggerState::set_metrics
+    static void set_metrics(const bool enable) {
+        state_.set_metrics(enable);
+    }
+
+    static LoggerMetrics metrics() {
+        return state_.metrics();
+    }
+
+    // 每隔 interval 向 sink 写一条指标摘要, sink 为空时停止
+    static void report_metrics(std::shared_ptr<Sink> sink, std::chrono::milliseconds interval) {
+        state_.report_metrics(std::move(sink), interval);
     }
 
     template <typename... Args>
@@ -85,6 +1220,38 @@ public:
         format<Level::Fatal, true>(wrapper, std::forward<Args>(args)...);
     }
 
+    // 按调用处限流的版本, site 为该调用处的静态限流对象 (见 limit.hpp), 在格式化和入队之前判断.
+    // 一般通过 HUXINT_WARN_EVERY_N 等宏使用
+    template <SiteLimiter S, typename... Args>
+    static void trace(S &site, fmt_loc_wrapper<Args...> wrapper, Args &&...args) {
+        limited<Level::Trace>(site, wrapper, std::forward<Args>(args)...);
+    }
+
+    template <SiteLimiter S, typename... Args>
+    static void debug(S &site, fmt_loc_wrapper<Args...> wrapper, Args &&...args) {
+        limited<Level::Debug>(site, wrapper, std::forward<Args>(args)...);
+    }
+
+    template <SiteLimiter S, typename... Args>
+    static void info(S &site, fmt_loc_wrapper<Args...> wrapper, Args &&...args) {
+        limited<Level::Info>(site, wrapper, std::forward<Args>(args)...);
+    }
+
+    template <SiteLimiter S, typename... Args>
+    static void warn(S &site, fmt_loc_wrapper<Args...> wrapper, Args &&...args) {
+        limited<Level::Warn>(site, wrapper, std::forward<Args>(args)...);
+    }
+
+    template <SiteLimiter S, typename... Args>
+    static void error(S &site, fmt_loc_wrapper<Args...> wrapper, Args &&...args) {
+        limited<Level::Error>(site, wrapper, std::forward<Args>(args)...);
+    }
+
+    template <SiteLimiter S, typename... Args>
+    static void fatal(S &site, fmt_loc_wrapper<Args...> wrapper, Args &&...args) {
+        limited<Level::Fatal>(site, wrapper, std::forward<Args>(args)...);
+    }
+
     // 不带文件名和行号的版本
     template <typename... Args>
     static void trace_raw(std::format_string<Args...> fmt, Args &&...args) {
@@ -120,32 +1287,124 @@ public:
         state_.flush();
     }
 
+    // 不阻塞的 flush, 完成后在后台线程调用 done (应当很快返回, 如投递到事件循环)
+    static void flush(std::function<void()> done) {
+        state_.flush(std::move(done));
+    }
+
+    // co_await Logger::async_flush(resume); 恢复时调用前的日志都已交给 sink. resume(std::coroutine_handle<>)
+    // 在后台线程上调用, 应把协程投递回自己的执行器, 不要直接恢复
+    template <typename Resume>
+        requires std::invocable<Resume &, std::coroutine_handle<>>
+    static FlushAwaiter<LogEntry, Resume> async_flush(Resume resume) {
+        return state_.async_flush(std::move(resume));
+    }
+
     static constexpr std::string_view name() {
         return Name;
     }
 
 private:
     template <Level lv, bool Location, typename Fmt, typename... Args>
-    static void format(Fmt &&fmt, Args &&...args) {
-        if (lv < level()) {
-            return;
+    static void format([[maybe_unused]] Fmt &&fmt, [[maybe_unused]] Args &&...args) {
+        // 低于 MinLevel 时整个函数体为空
+        if constexpr (lv >= MinLevel) {
+            if (lv >= state_.threshold()) {
+                if constexpr (lv >= Level::Error) {
+                    if (state_.backtrace() != 0) {
+                        state_.dump_backtrace();
+                    }
+                }
+                submit<lv, Location>(std::forward<Fmt>(fmt), std::forward<Args>(args)...);
+                if constexpr (lv == Level::Fatal) {
+                    if (state_.fatal_write_through()) {
+                        state_.sync();
+                    }
+                }
+            } else if (state_.backtrace() != 0) {
+                submit<lv, Location, true>(std::forward<Fmt>(fmt), std::forward<Args>(args)...);
+            }
         }
-        std::string msg;
+    }
+
+    template <Level lv, typename S, typename... Args>
+    static void limited([[maybe_unused]] S &site,
+                        [[maybe_unused]] fmt_loc_wrapper<Args...> wrapper,
+                        [[maybe_unused]] Args &&...args) {
+        if constexpr (lv >= MinLevel) {
+            if (lv < state_.threshold()) {
+                // 不限流, 直接交给 format 存进 backtrace (未开启时 format 什么也不做)
+                format<lv, true>(wrapper, std::forward<Args>(args)...);
+                return;
+            }
+            const auto verdict = site.check(args...);
+            const std::string_view file = wrapper.location().file_name();
+            const auto line = wrapper.location().line();
+            const auto sinks = verdict.suppressed != 0 ? state_.route(lv, Name.str(), file, line) : 0;
+            if (sinks != 0) {
+                // 汇总只带一个计数参数, 同样在后台线程格式化
+                state_.push(state_.overflow(lv),
+                            lv,
+                            sinks,
+                            Name.str(),
+                            file,
+                            line,
+                            std::chrono::system_clock::now(),
+                            S::summary,
+                            verdict.suppressed);
+            }
+            if (verdict.emit) {
+                format<lv, true>(wrapper, std::forward<Args>(args)...);
+            }
+        }
+    }
+
+    // Backtrace 为 true 时不入队, 存进本线程的 backtrace 环形缓冲
+    template <Level lv, bool Location, bool Backtrace = false, typename Fmt, typename... Args>
+    static void submit(Fmt &&fmt, Args &&...args) {
+        const auto time = std::chrono::system_clock::now();
+        std::string_view format;
         std::string_view file;
         std::uint32_t line = 0;
         if constexpr (Location) {
-            msg = std::format(fmt.format(), std::forward<Args>(args)...);
+            format = fmt.format().get();
             file = fmt.location().file_name();
             line = fmt.location().line();
         } else {
-            msg = std::format(std::forward<Fmt>(fmt), std::forward<Args>(args)...);
+            format = fmt.get();
         }
-        for (auto &sink : state_.sinks) {
-            auto *p = sink.get();
-            state_.pool->submit([p, msg, file, line] {
-                p->write(lv, Name.str(), msg, file, line);
-            });
+        // 没有 sink 要时不格式化也不入队
+        std::uint64_t sinks = LogEntry::all_sinks;
+        if constexpr (!Backtrace) {
+            sinks = state_.route(lv, Name.str(), file, line);
+            if (sinks == 0) {
+                return;
+            }
+        }
+        auto put = [&](auto &&...entry) {
+            if constexpr (Backtrace) {
+                state_.remember(lv, std::forward<decltype(entry)>(entry)...);
+            } else {
+                state_.push(state_.overflow(lv), lv, sinks, std::forward<decltype(entry)>(entry)...);
+            }
+        };
+        // 参数可编码时只拷贝参数, 格式化留给后台线程. 带 kv() 字段时不论大小都编码入队, 字段到 sink 时仍是原始类型
+        if constexpr (Deferrable<Args...>) {
+            if (HasFields<Args...> || encoded_size(args...) <= LogEntry::inline_size) {
+                put(Name.str(), file, line, time, format, args...);
+                return;
+            }
+        } else {
+            static_assert(!HasFields<Args...>, "kv() 字段的调用中所有参数都必须可编码 (见 codec.hpp)");
+        }
+        // 否则格式化到本线程复用的缓冲, 短消息随后拷进队列槽位
+        auto &buffer = detail::format_buffer();
+        if constexpr (Location) {
+            std::format_to(std::back_inserter(buffer), fmt.format(), std::forward<Args>(args)...);
+        } else {
+            std::format_to(std::back_inserter(buffer), std::forward<Fmt>(fmt), std::forward<Args>(args)...);
         }
+        put(Name.str(), file, line, time, LogEntry::Text{buffer});
     }
 };
 
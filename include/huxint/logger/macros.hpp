@@ -0,0 +1,57 @@
+#pragma once
+#include "logger.hpp"
+
+// 可选的宏前端: 级别未开启时不对参数求值, 低于编译期最低级别时整条语句被剔除.
+// logger 为 Logger 类型, 含逗号的模板实参需先用 using 起别名, 例如
+//   using app = huxint::Logger<"app", huxint::Level::Info>;
+//   HUXINT_DEBUG(app, "state: {}", dump_state());
+#define HUXINT_LOG_AT(logger, lv, method, ...)                                                                         \
+    do {                                                                                                               \
+        if constexpr (::huxint::Level::lv >= logger::min_level()) {                                                   \
+            if (logger::enabled(::huxint::Level::lv)) {                                                                \
+                logger::method(__VA_ARGS__);                                                                           \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+#define HUXINT_TRACE(logger, ...) HUXINT_LOG_AT(logger, Trace, trace, __VA_ARGS__)
+#define HUXINT_DEBUG(logger, ...) HUXINT_LOG_AT(logger, Debug, debug, __VA_ARGS__)
+#define HUXINT_INFO(logger, ...) HUXINT_LOG_AT(logger, Info, info, __VA_ARGS__)
+#define HUXINT_WARN(logger, ...) HUXINT_LOG_AT(logger, Warn, warn, __VA_ARGS__)
+#define HUXINT_ERROR(logger, ...) HUXINT_LOG_AT(logger, Error, error, __VA_ARGS__)
+#define HUXINT_FATAL(logger, ...) HUXINT_LOG_AT(logger, Fatal, fatal, __VA_ARGS__)
+
+// 按调用处限流, 每处展开一个静态的限流对象 (见 limit.hpp). 被拦下的调用只对参数求值, 不编码也不格式化. Fatal 不限流
+//   HUXINT_WARN_EVERY_N(app, 1000, "retry {}", attempt);          第 1, 1001, 2001 ... 次写出
+//   HUXINT_ERROR_PER_SECOND(app, 10, "connect failed: {}", err);   每秒最多 10 条, 之后补写被拦下的条数
+//   HUXINT_ERROR_DEDUP(app, "connect failed: {}", err);            连续相同的参数只写一次, 之后补写重复次数
+#define HUXINT_LOG_LIMITED(logger, lv, method, site, ...)                                                              \
+    do {                                                                                                               \
+        if constexpr (::huxint::Level::lv >= logger::min_level()) {                                                   \
+            if (logger::enabled(::huxint::Level::lv)) {                                                                \
+                static auto huxint_site_ = site;                                                                       \
+                logger::method(huxint_site_, __VA_ARGS__);                                                             \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (false)
+
+#define HUXINT_TRACE_EVERY_N(logger, n, ...) HUXINT_LOG_LIMITED(logger, Trace, trace, ::huxint::EveryN(n), __VA_ARGS__)
+#define HUXINT_DEBUG_EVERY_N(logger, n, ...) HUXINT_LOG_LIMITED(logger, Debug, debug, ::huxint::EveryN(n), __VA_ARGS__)
+#define HUXINT_INFO_EVERY_N(logger, n, ...) HUXINT_LOG_LIMITED(logger, Info, info, ::huxint::EveryN(n), __VA_ARGS__)
+#define HUXINT_WARN_EVERY_N(logger, n, ...) HUXINT_LOG_LIMITED(logger, Warn, warn, ::huxint::EveryN(n), __VA_ARGS__)
+#define HUXINT_ERROR_EVERY_N(logger, n, ...) HUXINT_LOG_LIMITED(logger, Error, error, ::huxint::EveryN(n), __VA_ARGS__)
+
+#define HUXINT_TRACE_PER_SECOND(logger, n, ...)                                                                        \
+    HUXINT_LOG_LIMITED(logger, Trace, trace, ::huxint::PerSecond(n), __VA_ARGS__)
+#define HUXINT_DEBUG_PER_SECOND(logger, n, ...)                                                                        \
+    HUXINT_LOG_LIMITED(logger, Debug, debug, ::huxint::PerSecond(n), __VA_ARGS__)
+#define HUXINT_INFO_PER_SECOND(logger, n, ...) HUXINT_LOG_LIMITED(logger, Info, info, ::huxint::PerSecond(n), __VA_ARGS__)
+#define HUXINT_WARN_PER_SECOND(logger, n, ...) HUXINT_LOG_LIMITED(logger, Warn, warn, ::huxint::PerSecond(n), __VA_ARGS__)
+#define HUXINT_ERROR_PER_SECOND(logger, n, ...)                                                                        \
+    HUXINT_LOG_LIMITED(logger, Error, error, ::huxint::PerSecond(n), __VA_ARGS__)
+
+#define HUXINT_TRACE_DEDUP(logger, ...) HUXINT_LOG_LIMITED(logger, Trace, trace, ::huxint::Dedup(), __VA_ARGS__)
+#define HUXINT_DEBUG_DEDUP(logger, ...) HUXINT_LOG_LIMITED(logger, Debug, debug, ::huxint::Dedup(), __VA_ARGS__)
+#define HUXINT_INFO_DEDUP(logger, ...) HUXINT_LOG_LIMITED(logger, Info, info, ::huxint::Dedup(), __VA_ARGS__)
+#define HUXINT_WARN_DEDUP(logger, ...) HUXINT_LOG_LIMITED(logger, Warn, warn, ::huxint::Dedup(), __VA_ARGS__)
+#define HUXINT_ERROR_DEDUP(logger, ...) HUXINT_LOG_LIMITED(logger, Error, error, ::huxint::Dedup(), __VA_ARGS__)
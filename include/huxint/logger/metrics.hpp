@@ -0,0 +1,143 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "level.hpp"
+
+// 日志系统自身的运行指标: 各级别提交/写出/丢弃条数, 队列深度, 入队到写出的延迟分布, 每个 sink 的耗时
+namespace huxint {
+// 延迟直方图, 第 i 个桶统计 [2^(i-1), 2^i) 纳秒, 第 0 个桶只有 0
+struct LatencyHistogram {
+    static constexpr std::size_t buckets = 40; // 最后一个桶约 4.6 分钟以上
+
+    std::array<std::uint64_t, buckets> counts{};
+
+    static constexpr std::size_t bucket(std::chrono::nanoseconds latency) {
+        const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0));
+        return std::min<std::size_t>(std::bit_width(ns), buckets - 1);
+    }
+
+    std::uint64_t count() const {
+        return std::accumulate(counts.begin(), counts.end(), std::uint64_t{0});
+    }
+
+    // 第 p (0~1) 分位所在桶的上界, 没有样本时为 0
+    std::chrono::nanoseconds percentile(double p) const {
+        const auto total = count();
+        if (total == 0) {
+            return {};
+        }
+        const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(p * static_cast<double>(total) + 0.5));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < buckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::chrono::nanoseconds{(std::int64_t{1} << i) - 1};
+            }
+        }
+        return std::chrono::nanoseconds{(std::int64_t{1} << (buckets - 1)) - 1};
+    }
+};
+
+// 一个 sink 在某个 logger 下的累计数据; 挂在多个 logger 上的 sink 分别统计
+struct SinkMetrics {
+    std::uint64_t records = 0;
+    std::uint64_t batches = 0;            // write_batch 调用次数
+    std::chrono::nanoseconds write_time{}; // 以下耗时在 set_metrics(true) 时统计
+    std::uint64_t flushes = 0;
+    std::chrono::nanoseconds flush_time{};
+};
+
+// LoggerState::metrics() 返回的快照
+struct LoggerMetrics {
+    std::string name;
+    std::array<std::uint64_t, 6> submitted{}; // 按级别, 通过级别过滤进入队列的条数, 含之后被丢弃的
+    std::array<std::uint64_t, 6> written{};   // 已交给 sink
+    std::array<std::uint64_t, 6> dropped{};   // 因队列满被丢弃
+    std::size_t queue_depth = 0;              // 生产者队列中尚未取出的条数, 所有 logger 共用队列, 是全进程的数字
+    std::size_t peak_queue_depth = 0;         // 后台线程一轮取出的最多条数
+    LatencyHistogram latency;                 // 调用到交给 sink 的延迟, set_metrics(true) 时统计
+    std::vector<SinkMetrics> sinks;           // 与 sinks() 顺序一致
+
+    static std::uint64_t total(const std::array<std::uint64_t, 6> &counts) {
+        return std::accumulate(counts.begin(), counts.end(), std::uint64_t{0});
+    }
+
+    // 一行摘要, 用于周期性的统计日志
+    std::string summary() const {
+        auto out = std::format("metrics submitted={} written={} dropped={} queue={} peak={}",
+                               total(submitted),
+                               total(written),
+                               total(dropped),
+                               queue_depth,
+                               peak_queue_depth);
+        if (latency.count() != 0) {
+            std::format_to(std::back_inserter(out),
+                           " latency_ns p50<={} p99<={} max<={}",
+                           latency.percentile(0.5).count(),
+                           latency.percentile(0.99).count(),
+                           latency.percentile(1.0).count());
+        }
+        for (std::size_t i = 0; i < sinks.size(); ++i) {
+            const auto &sink = sinks[i];
+            std::format_to(std::back_inserter(out),
+                           " sink{}={{records={} batches={} write_us={} flushes={} flush_us={}}}",
+                           i,
+                           sink.records,
+                           sink.batches,
+                           std::chrono::duration_cast<std::chrono::microseconds>(sink.write_time).count(),
+                           sink.flushes,
+                           std::chrono::duration_cast<std::chrono::microseconds>(sink.flush_time).count());
+        }
+        return out;
+    }
+};
+
+namespace detail {
+// 单写者计数器: 只有一个线程累加, 其他线程随时读取, 不需要原子读改写
+class Counter {
+public:
+    void add(std::uint64_t n = 1) {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t get() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> value_{0};
+};
+
+// 由写这个 sink 的线程 (后台线程或其所在的工作线程) 累加
+struct SinkCounters {
+    Counter records;
+    Counter batches;
+    Counter write_ns;
+    Counter flushes;
+    Counter flush_ns;
+
+    SinkMetrics load() const {
+        return {records.get(),
+                batches.get(),
+                std::chrono::nanoseconds(write_ns.get()),
+                flushes.get(),
+                std::chrono::nanoseconds(flush_ns.get())};
+    }
+};
+
+// 生产者线程各自一份, 提交路径上不与其他线程争用缓存行
+struct alignas(64) ThreadCounters {
+    std::array<Counter, 6> submitted;
+};
+} // namespace detail
+} // namespace huxint
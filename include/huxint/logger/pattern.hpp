@@ -0,0 +1,439 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "codec.hpp"
+#include "level.hpp"
+#include "record.hpp"
+#include "timestamp.hpp"
+#include "util.hpp"
+
+// 日志行布局. 语法:
+//   {time} {level} {name} {file} {line} {msg} {fields} {color} {reset}  字段
+//   {? ... ?}  可选段, 段内任一字段为空 (name/file/msg 为空串, line 为 0, 没有 kv() 字段) 时整段省略
+//   {{ }}      字面量花括号
+namespace huxint {
+namespace detail {
+enum class Field : std::uint8_t {
+    Literal,
+    Time,
+    Level,
+    Name,
+    File,
+    Line,
+    Msg,
+    Fields,
+    Color,
+    Reset,
+    GroupBegin,
+    GroupEnd,
+};
+
+struct Token {
+    Field field = Field::Literal;
+    std::uint16_t offset = 0; // Literal: 在布局串中的偏移; GroupBegin: 对应 GroupEnd 的下标
+    std::uint16_t size = 0;   // Literal: 长度
+};
+
+constexpr Field field_of(std::string_view name) {
+    if (name == "time") {
+        return Field::Time;
+    }
+    if (name == "level") {
+        return Field::Level;
+    }
+    if (name == "name") {
+        return Field::Name;
+    }
+    if (name == "file") {
+        return Field::File;
+    }
+    if (name == "line") {
+        return Field::Line;
+    }
+    if (name == "msg") {
+        return Field::Msg;
+    }
+    if (name == "fields") {
+        return Field::Fields;
+    }
+    if (name == "color") {
+        return Field::Color;
+    }
+    if (name == "reset") {
+        return Field::Reset;
+    }
+    throw std::invalid_argument("Unknown field in log pattern");
+}
+
+// 解析布局串, out 为空时只计数. 编译期和运行期共用
+constexpr std::size_t parse_pattern(std::string_view pattern, Token *out) {
+    std::size_t count = 0;
+    std::size_t group = pattern.size(); // 当前可选段 GroupBegin 的下标, 不支持嵌套
+    std::size_t literal = 0;
+    auto emit = [&](Token token) {
+        if (out != nullptr) {
+            out[count] = token;
+        }
+        ++count;
+    };
+    auto emit_literal = [&](std::size_t end) {
+        if (end > literal) {
+            emit({Field::Literal, static_cast<std::uint16_t>(literal), static_cast<std::uint16_t>(end - literal)});
+        }
+    };
+    std::size_t i = 0;
+    while (i < pattern.size()) {
+        const char c = pattern[i];
+        const char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+        if ((c == '{' && next == '{') || (c == '}' && next == '}')) {
+            emit_literal(i);
+            emit({Field::Literal, static_cast<std::uint16_t>(i), 1});
+            i += 2;
+        } else if (c == '{' && next == '?') {
+            if (group != pattern.size()) {
+                throw std::invalid_argument("Nested optional group in log pattern");
+            }
+            emit_literal(i);
+            group = count;
+            emit({Field::GroupBegin});
+            i += 2;
+        } else if (c == '?' && next == '}' && group != pattern.size()) {
+            emit_literal(i);
+            if (out != nullptr) {
+                out[group].offset = static_cast<std::uint16_t>(count);
+            }
+            group = pattern.size();
+            emit({Field::GroupEnd});
+            i += 2;
+        } else if (c == '{') {
+            const auto close = pattern.find('}', i);
+            if (close == std::string_view::npos) {
+                throw std::invalid_argument("Unterminated field in log pattern");
+            }
+            emit_literal(i);
+            emit({field_of(pattern.substr(i + 1, close - i - 1))});
+            i = close + 1;
+        } else if (c == '}') {
+            throw std::invalid_argument("Unmatched '}' in log pattern");
+        } else {
+            ++i;
+            continue;
+        }
+        literal = i;
+    }
+    emit_literal(pattern.size());
+    if (group != pattern.size()) {
+        throw std::invalid_argument("Unterminated optional group in log pattern");
+    }
+    return count;
+}
+
+// 字段是否为空, 决定可选段是否输出
+constexpr bool present(Field field, const Record &record) {
+    switch (field) {
+        case Field::Name:
+            return !record.name.empty();
+        case Field::File:
+            return !record.file.empty();
+        case Field::Line:
+            return record.line != 0;
+        case Field::Msg:
+            return !record.msg.empty();
+        case Field::Fields:
+            return record.fields != 0;
+        default:
+            return true;
+    }
+}
+
+// kv() 字段的值按 "{}" 输出的长度上界, 字符串按实际长度
+inline constexpr std::size_t value_bound = 40;
+
+inline std::size_t fields_bound(const Record &record) {
+    std::size_t size = 0;
+    if (record.fields != 0) {
+        visit_tagged(record.args, [&](std::string_view key, const TaggedArg &value) {
+            if (!key.empty()) {
+                const auto *text = std::get_if<std::string_view>(&value);
+                size += key.size() + 2 + (text != nullptr ? text->size() : value_bound);
+            }
+        });
+    }
+    return size;
+}
+
+// 字段输出长度的上界 (不含字面量)
+inline std::size_t field_bound(Field field, const Record &record) {
+    switch (field) {
+        case Field::Time:
+            return TimestampCache::max_size;
+        case Field::Level:
+            return 5;
+        case Field::Name:
+            return record.name.size();
+        case Field::File:
+            return record.file.size();
+        case Field::Line:
+            return 10;
+        case Field::Msg:
+            return record.msg.size();
+        case Field::Fields:
+            return fields_bound(record);
+        case Field::Color:
+        case Field::Reset:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+inline void put(std::string &out, std::string_view text) {
+    out.append(text);
+}
+
+// 调用方需保证空间足够
+inline void put(char *&out, std::string_view text) {
+    std::memcpy(out, text.data(), text.size());
+    out += text.size();
+}
+
+template <typename T>
+void put_value(std::string &out, const T &value) {
+    std::format_to(std::back_inserter(out), "{}", value);
+}
+
+template <typename T>
+void put_value(char *&out, const T &value) {
+    out = std::format_to(out, "{}", value);
+}
+
+// kv() 字段输出为 "key=value key=value", 值不加引号
+template <typename Out>
+void append_fields(Out &out, const Record &record) {
+    if (record.fields == 0) {
+        return;
+    }
+    bool first = true;
+    visit_tagged(record.args, [&](std::string_view key, const TaggedArg &value) {
+        if (key.empty()) {
+            return;
+        }
+        if (!first) {
+            put(out, " ");
+        }
+        first = false;
+        put(out, key);
+        put(out, "=");
+        std::visit(
+            [&](const auto &v) {
+                put_value(out, v);
+            },
+            value);
+    });
+}
+
+// 右对齐到 5 个字符的级别名, 与 "{:>5}" 一致
+constexpr std::string_view padded_level(Level level) {
+    constexpr std::string_view names = "TRACEDEBUG INFO WARNERRORFATAL";
+    return names.substr(static_cast<std::size_t>(level) * 5, 5);
+}
+
+template <typename Out>
+void append_field(Out &out,
+                  Field field,
+                  std::string_view literal,
+                  const Record &record,
+                  TimestampCache &timestamp,
+                  bool color) {
+    switch (field) {
+        case Field::Literal:
+            put(out, literal);
+            break;
+        case Field::Time:
+            put(out, timestamp.format(record.time));
+            break;
+        case Field::Level:
+            put(out, padded_level(record.level));
+            break;
+        case Field::Name:
+            put(out, record.name);
+            break;
+        case Field::File:
+            put(out, record.file);
+            break;
+        case Field::Line: {
+            char digits[10];
+            const auto end = std::to_chars(digits, digits + sizeof(digits), record.line).ptr;
+            put(out, {digits, static_cast<std::size_t>(end - digits)});
+            break;
+        }
+        case Field::Msg:
+            put(out, record.msg);
+            break;
+        case Field::Fields:
+            append_fields(out, record);
+            break;
+        case Field::Color:
+            if (color) {
+                put(out, color_code(record.level));
+            }
+            break;
+        case Field::Reset:
+            if (color) {
+                put(out, reset_code());
+            }
+            break;
+        default:
+            break;
+    }
+}
+} // namespace detail
+
+// 编译期布局, 解析结果展开为固定的追加操作序列
+template <String S>
+class Pattern {
+    static constexpr std::string_view pattern_ = S;
+    static constexpr std::size_t count_ = detail::parse_pattern(pattern_, nullptr);
+    static constexpr auto tokens_ = [] {
+        std::array<detail::Token, count_> tokens{};
+        detail::parse_pattern(pattern_, tokens.data());
+        return tokens;
+    }();
+
+public:
+    static constexpr std::string_view str() {
+        return pattern_;
+    }
+
+    template <typename Out>
+    void render(Out &out, const Record &record, TimestampCache &timestamp, bool color = true) const {
+        emit<0>(out, record, timestamp, color);
+    }
+
+    std::size_t bound(const Record &record) const {
+        return [&]<std::size_t... I>(std::index_sequence<I...>) {
+            return (std::size_t{0} + ... + token_bound<I>(record));
+        }(std::make_index_sequence<count_>{});
+    }
+
+private:
+    template <std::size_t I, typename Out>
+    static void emit(Out &out, const Record &record, TimestampCache &timestamp, bool color) {
+        if constexpr (I < count_) {
+            constexpr auto token = tokens_[I];
+            if constexpr (token.field == detail::Field::GroupBegin) {
+                if (visible<I + 1>(record, std::make_index_sequence<token.offset - I - 1>{})) {
+                    emit<I + 1>(out, record, timestamp, color);
+                } else {
+                    emit<token.offset + 1>(out, record, timestamp, color);
+                }
+            } else {
+                detail::append_field(out, token.field, literal<I>(), record, timestamp, color);
+                emit<I + 1>(out, record, timestamp, color);
+            }
+        }
+    }
+
+    template <std::size_t Begin, std::size_t... I>
+    static bool visible(const Record &record, std::index_sequence<I...>) {
+        return (detail::present(tokens_[Begin + I].field, record) && ...);
+    }
+
+    template <std::size_t I>
+    static constexpr std::string_view literal() {
+        if constexpr (tokens_[I].field == detail::Field::Literal) {
+            return pattern_.substr(tokens_[I].offset, tokens_[I].size);
+        } else {
+            return {};
+        }
+    }
+
+    template <std::size_t I>
+    static std::size_t token_bound(const Record &record) {
+        if constexpr (tokens_[I].field == detail::Field::Literal) {
+            return tokens_[I].size;
+        } else {
+            return detail::field_bound(tokens_[I].field, record);
+        }
+    }
+};
+
+// 运行期布局, 构造时解析一次, 之后每条记录只按 token 顺序追加
+class Layout {
+public:
+    Layout(std::string_view pattern) // NOLINT(google-explicit-constructor) 允许直接传字符串
+    : pattern_(pattern) {
+        tokens_.resize(detail::parse_pattern(pattern_, nullptr));
+        detail::parse_pattern(pattern_, tokens_.data());
+        for (const auto &token : tokens_) {
+            if (token.field == detail::Field::Literal) {
+                literal_size_ += token.size;
+            }
+        }
+    }
+
+    std::string_view str() const {
+        return pattern_;
+    }
+
+    template <typename Out>
+    void render(Out &out, const Record &record, TimestampCache &timestamp, bool color = true) const {
+        for (std::size_t i = 0; i < tokens_.size(); ++i) {
+            const auto &token = tokens_[i];
+            if (token.field == detail::Field::GroupBegin) {
+                if (!visible(i + 1, token.offset, record)) {
+                    i = token.offset;
+                }
+                continue;
+            }
+            detail::append_field(out, token.field, literal(token), record, timestamp, color);
+        }
+    }
+
+    std::size_t bound(const Record &record) const {
+        auto size = literal_size_;
+        for (const auto &token : tokens_) {
+            size += detail::field_bound(token.field, record);
+        }
+        return size;
+    }
+
+private:
+    bool visible(std::size_t begin, std::size_t end, const Record &record) const {
+        for (auto i = begin; i < end; ++i) {
+            if (!detail::present(tokens_[i].field, record)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string_view literal(const detail::Token &token) const {
+        if (token.field != detail::Field::Literal) {
+            return {};
+        }
+        return std::string_view(pattern_).substr(token.offset, token.size);
+    }
+
+    std::string pattern_;
+    std::vector<detail::Token> tokens_;
+    std::size_t literal_size_ = 0;
+};
+
+// 默认布局, 与原先各 sink 的输出一致
+using FilePattern = Pattern<"[time: {time}][{level}]{?<{name}>?} {?{file}:{line} ?}{msg}{? {fields}?}">;
+using ConsolePattern = Pattern<"[{level}]{?<{name}>?} {?{file}:{line} ?}{msg}{? {fields}?}">;
+using ColorConsolePattern =
+    Pattern<"{color}[{level}]{?<{name}>?}{reset} {?\033[32m{file}:{line}{reset} ?}{msg}{? {fields}?}">;
+} // namespace huxint
\ No newline at end of file
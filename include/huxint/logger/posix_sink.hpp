@@ -0,0 +1,282 @@
+#pragma once
+#if defined(__unix__) || defined(__APPLE__)
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pattern.hpp"
+#include "record.hpp"
+#include "sink.hpp"
+#include "timestamp.hpp"
+
+namespace huxint {
+// 落盘策略
+enum class SyncPolicy : std::uint8_t {
+    Never,      // 只 write, 由内核回写
+    EveryBytes, // 每写出 sync_bytes 字节 fdatasync 一次
+    OnError,    // 批次中出现 Error/Fatal 时立即写出并 fdatasync
+};
+
+struct PosixFileOptions {
+    std::size_t buffer_size = 256 * 1024; // 自有缓冲区大小, 建议 64 KiB ~ 数 MiB
+    bool append = true;                   // O_APPEND, 否则打开时定位到末尾后由本 sink 独占写入
+    bool direct = false;                  // O_DIRECT, 绕过页缓存, 按块对齐写入 (仅 Linux)
+    SyncPolicy sync = SyncPolicy::Never;
+    std::size_t sync_bytes = 1 << 20;     // SyncPolicy::EveryBytes 的间隔
+    Precision precision = Precision::Seconds;
+};
+
+// 基于 open/write 的文件输出, 直接格式化进自有缓冲区, 缓冲区满或 flush 时才写出
+template <typename P>
+class BasicPosixFileSink final : public Sink {
+public:
+    explicit BasicPosixFileSink(const std::string &filename, PosixFileOptions options = {}, P layout = {})
+    : options_(options),
+      layout_(std::move(layout)),
+      timestamp_(options.precision) {
+        int flags = O_WRONLY | O_CREAT | O_CLOEXEC;
+        if (options_.direct) {
+#ifdef O_DIRECT
+            // 直接 I/O 用 pwrite 按块对齐写, 不能与 O_APPEND 同用; 需要读回末尾不足一块的内容
+            flags = O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT;
+#else
+            throw std::runtime_error("O_DIRECT is not supported on this platform");
+#endif
+        } else if (options_.append) {
+            flags |= O_APPEND;
+        }
+        fd_ = ::open(filename.c_str(), flags, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Failed to open log file: " + filename);
+        }
+        capacity_ = std::max(options_.buffer_size, 2 * block_size);
+        if (options_.direct) {
+            capacity_ = (capacity_ + block_size - 1) / block_size * block_size;
+        }
+        buffer_.reset(static_cast<char *>(::operator new[](capacity_, std::align_val_t{block_size})));
+        if (options_.direct) {
+            load_tail();
+        } else if (!options_.append) {
+            ::lseek(fd_, 0, SEEK_END);
+        }
+    }
+
+    BasicPosixFileSink(const BasicPosixFileSink &) = delete;
+    BasicPosixFileSink &operator=(const BasicPosixFileSink &) = delete;
+
+    ~BasicPosixFileSink() override {
+        flush();
+        ::close(fd_);
+    }
+
+    void write(const Record &record) override {
+        write_batch({&record, 1});
+    }
+
+    void write_batch(std::span<const Record> records) override {
+        std::scoped_lock lock(mutex_);
+        bool urgent = false;
+        for (const auto &record : records) {
+            append(record);
+            urgent = urgent || record.level >= Level::Error;
+        }
+        if (urgent && options_.sync == SyncPolicy::OnError) {
+            drain(true);
+            datasync();
+        }
+    }
+
+    void flush() override {
+        std::scoped_lock lock(mutex_);
+        drain(true);
+    }
+
+    void sync() override {
+        std::scoped_lock lock(mutex_);
+        drain(true);
+        datasync();
+    }
+
+    // 不加锁: 先写出缓冲区中已有的内容, 再直接写这一行. 直接 I/O 要求对齐写入, 不支持
+    bool crash_write(const Record &record) override {
+        if (options_.direct) {
+            return false;
+        }
+        if (size_ != 0) {
+            detail::write_fd(fd_, {buffer_.get(), size_});
+            size_ = 0;
+        }
+        char line[2048];
+        TimestampCache timestamp(options_.precision);
+        detail::write_fd(fd_, detail::render_bounded(line, record, layout_, timestamp, false));
+        return true;
+    }
+
+    // 已发出的 write/pwrite/fdatasync 次数
+    std::size_t syscalls() const {
+        std::scoped_lock lock(mutex_);
+        return syscalls_;
+    }
+
+private:
+    struct AlignedDelete {
+        void operator()(char *p) const {
+            ::operator delete[](p, std::align_val_t{block_size});
+        }
+    };
+
+    void append(const Record &record) {
+        const auto bound = layout_.bound(record) + 1;
+        if (bound > capacity_ - size_) {
+            drain(false);
+        }
+        if (bound <= capacity_ - size_) {
+            auto *out = buffer_.get() + size_;
+            layout_.render(out, record, timestamp_, false);
+            *out++ = '\n';
+            size_ = static_cast<std::size_t>(out - buffer_.get());
+            return;
+        }
+        // 单行比整个缓冲区还大, 分段拷贝进缓冲区
+        std::string line;
+        layout_.render(line, record, timestamp_, false);
+        line.push_back('\n');
+        std::string_view rest = line;
+        while (!rest.empty()) {
+            const auto n = std::min(rest.size(), capacity_ - size_);
+            std::memcpy(buffer_.get() + size_, rest.data(), n);
+            size_ += n;
+            rest.remove_prefix(n);
+            if (size_ == capacity_) {
+                drain(false);
+            }
+        }
+    }
+
+    // 把缓冲区写出. 直接 I/O 下 all 为 false 时只写完整的块, 余下部分留在缓冲区
+    void drain(bool all) {
+        if (size_ == 0) {
+            return;
+        }
+        if (!options_.direct) {
+            write_all(buffer_.get(), size_);
+            size_ = 0;
+            return;
+        }
+        const auto full = size_ / block_size * block_size;
+        const auto padded = all ? (size_ + block_size - 1) / block_size * block_size : full;
+        if (padded == 0) {
+            return;
+        }
+        if (padded > size_) {
+            std::memset(buffer_.get() + size_, 0, padded - size_);
+        }
+        pwrite_all(buffer_.get(), padded, offset_);
+        if (padded != full) {
+            // 补齐的零字节截掉, 未满的尾块下次连同新内容一起重写
+            ::ftruncate(fd_, static_cast<off_t>(offset_ + size_));
+            ++syscalls_;
+        }
+        std::memmove(buffer_.get(), buffer_.get() + full, size_ - full);
+        offset_ += full;
+        size_ -= full;
+    }
+
+    void write_all(const char *data, std::size_t n) {
+        const auto total = n;
+        while (n != 0) {
+            const auto written = ::write(fd_, data, n);
+            ++syscalls_;
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return; // 磁盘满等错误时丢弃, 不能让后台线程抛异常
+            }
+            data += written;
+            n -= static_cast<std::size_t>(written);
+        }
+        after_write(total);
+    }
+
+    void pwrite_all(const char *data, std::size_t n, std::size_t offset) {
+        const auto total = n;
+        while (n != 0) {
+            const auto written = ::pwrite(fd_, data, n, static_cast<off_t>(offset));
+            ++syscalls_;
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            data += written;
+            offset += static_cast<std::size_t>(written);
+            n -= static_cast<std::size_t>(written);
+        }
+        after_write(total);
+    }
+
+    void after_write(std::size_t n) {
+        if (options_.sync != SyncPolicy::EveryBytes) {
+            return;
+        }
+        unsynced_ += n;
+        if (unsynced_ >= options_.sync_bytes) {
+            datasync();
+        }
+    }
+
+    void datasync() {
+#ifdef __APPLE__
+        ::fsync(fd_);
+#else
+        ::fdatasync(fd_);
+#endif
+        ++syscalls_;
+        unsynced_ = 0;
+    }
+
+    // 直接 I/O 从最后一个对齐位置续写, 先把文件末尾不足一块的内容读回缓冲区
+    void load_tail() {
+        const auto end = ::lseek(fd_, 0, SEEK_END);
+        if (end < 0) {
+            return;
+        }
+        offset_ = static_cast<std::size_t>(end) / block_size * block_size;
+        if (static_cast<std::size_t>(end) == offset_) {
+            return;
+        }
+        const auto n = ::pread(fd_, buffer_.get(), block_size, static_cast<off_t>(offset_));
+        size_ = n > 0 ? static_cast<std::size_t>(n) : 0;
+    }
+
+    static constexpr std::size_t block_size = 4096;
+
+    PosixFileOptions options_;
+    P layout_;
+    TimestampCache timestamp_;
+    int fd_ = -1;
+    std::unique_ptr<char[], AlignedDelete> buffer_;
+    std::size_t capacity_ = 0;
+    std::size_t size_ = 0;
+    std::size_t offset_ = 0; // 直接 I/O 下缓冲区起点对应的文件偏移, 始终按块对齐
+    std::size_t unsynced_ = 0;
+    std::size_t syscalls_ = 0;
+    mutable std::mutex mutex_;
+};
+
+using PosixFileSink = BasicPosixFileSink<FilePattern>;
+} // namespace huxint
+#endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace huxint {
+// 单生产者单消费者环形队列, 每个生产者线程独占一个, 入队不加锁也不分配内存.
+// 每个槽位带序号: seq == pos 表示空闲, seq == pos + 1 表示已写入. 取出一条先 CAS 推进 head 认领,
+// 因此生产者也能安全地丢弃最旧的一条 (pop_oldest), 与消费者互不冲突
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(std::size_t capacity)
+    : capacity_(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity)),
+      mask_(capacity_ - 1),
+      slots_(std::make_unique<Slot[]>(capacity_)) {
+        for (std::size_t i = 0; i < capacity_; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    ~RingBuffer() {
+        for (auto i = head_.load(std::memory_order_relaxed); i != tail_.load(std::memory_order_relaxed); ++i) {
+            std::destroy_at(item(i));
+        }
+    }
+
+    // 生产者调用, 队列满时返回 false
+    template <typename... Args>
+    bool try_emplace(Args &&...args) {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        auto &slot = slots_[tail & mask_];
+        if (slot.seq.load(std::memory_order_acquire) != tail) {
+            return false; // 尚未被取走, 或消费者正在读取
+        }
+        std::construct_at(item(tail), std::forward<Args>(args)...);
+        slot.seq.store(tail + 1, std::memory_order_release);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 生产者调用, 丢弃最旧的一条, 析构前先交给 fn. 队列为空或该条刚被消费者认领时返回 false
+    template <typename F>
+    bool pop_oldest(F &&fn) {
+        auto head = head_.load(std::memory_order_acquire);
+        if (head == tail_.load(std::memory_order_relaxed) ||
+            !head_.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+            return false;
+        }
+        fn(*item(head));
+        release(head);
+        return true;
+    }
+
+    // 消费者调用, 最多取出 max 条交给 fn, 返回取出的条数
+    template <typename F>
+    std::size_t drain(F &&fn, std::size_t max) {
+        std::size_t n = 0;
+        while (n < max) {
+            auto head = head_.load(std::memory_order_acquire);
+            if (slots_[head & mask_].seq.load(std::memory_order_acquire) != head + 1) {
+                break;
+            }
+            if (!head_.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+                continue; // 被生产者丢弃
+            }
+            fn(std::move(*item(head)));
+            release(head);
+            ++n;
+        }
+        return n;
+    }
+
+    // 崩溃时调用, 认领剩余的每一条交给 fn, 但不析构也不交还槽位: 析构可能释放内存, 不是异步信号安全的
+    template <typename F>
+    void salvage(F &&fn) {
+        while (true) {
+            auto head = head_.load(std::memory_order_acquire);
+            if (slots_[head & mask_].seq.load(std::memory_order_acquire) != head + 1) {
+                return;
+            }
+            if (head_.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+                fn(*item(head));
+            }
+        }
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    // 近似的当前条数, 供其他线程观测
+    std::size_t size() const {
+        const auto head = head_.load(std::memory_order_acquire);
+        const auto tail = tail_.load(std::memory_order_acquire);
+        return std::min(tail - head, capacity_);
+    }
+
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    // 生产者线程退出时关闭, 后台取空后即可回收
+    void close() {
+        closed_.store(true, std::memory_order_release);
+    }
+
+    bool closed() const {
+        return closed_.load(std::memory_order_acquire);
+    }
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> seq;
+        alignas(T) std::byte data[sizeof(T)];
+    };
+
+    T *item(std::size_t pos) {
+        return std::launder(reinterpret_cast<T *>(slots_[pos & mask_].data));
+    }
+
+    // 认领者析构该条并把槽位交还给下一圈的生产者
+    void release(std::size_t pos) {
+        std::destroy_at(item(pos));
+        slots_[pos & mask_].seq.store(pos + capacity_, std::memory_order_release);
+    }
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<bool> closed_{false};
+    alignas(64) std::atomic<std::size_t> head_{0}; // 消费者推进, DropOldest 时生产者也会推进
+    alignas(64) std::atomic<std::size_t> tail_{0}; // 生产者写
+};
+} // namespace huxint
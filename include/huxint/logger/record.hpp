@@ -0,0 +1,32 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include "level.hpp"
+
+namespace huxint {
+// 一条日志记录, 每次调用只生成一条, 由后台线程按引用交给所有 sink, 不再逐 sink 拷贝
+struct Record {
+    Level level;
+    std::string_view name;
+    std::string_view msg; // 文本消息, 只有存在需要文本的 sink 时才会格式化
+    std::string_view file;
+    std::uint32_t line;
+    std::chrono::system_clock::time_point time; // 调用处的时间
+    std::uint32_t thread = 0;                   // 调用线程编号, 见 thread_id()
+    std::string_view format{};                  // 延迟格式化时的格式串, 否则为空
+    std::span<const std::byte> args{};          // 延迟格式化时带类型标签的参数编码, 见 codec.hpp; 之后接着上下文字段,
+                                                // format 为空时只有上下文字段
+    std::uint16_t fields = 0;                   // args 中 kv() 字段与上下文字段的个数, 见 visit_tagged
+};
+
+// 进程内从 1 开始递增的线程编号, 比 std::thread::id 紧凑, 便于写进日志
+inline std::uint32_t thread_id() {
+    static std::atomic<std::uint32_t> next{0};
+    thread_local const std::uint32_t id = next.fetch_add(1, std::memory_order_relaxed) + 1;
+    return id;
+}
+} // namespace huxint
@@ -0,0 +1,209 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include "compress.hpp"
+#include "pattern.hpp"
+#include "record.hpp"
+#include "sink.hpp"
+#include "timestamp.hpp"
+#include "worker.hpp"
+#if defined(__linux__)
+#include <sys/resource.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace huxint {
+// 按时间轮转的边界 (UTC, 与时间戳一致)
+enum class Rotation : std::uint8_t { None, Hourly, Daily };
+
+struct RotatingFileOptions {
+    std::size_t max_size = 64 << 20;          // 单个文件上限, 0 表示不按大小轮转
+    Rotation rotation = Rotation::None;
+    std::size_t max_files = 5;                // 保留的历史文件数, 0 表示全部保留
+    bool compress = false;                    // 历史文件在后台线程压缩, 见 compress.hpp
+    Precision precision = Precision::Seconds;
+};
+
+// 轮转文件输出: 当前文件为 filename, 历史文件为 filename.1, filename.2 ... 序号递增, 不做重命名移位.
+// 写出和换文件在后台线程完成; 压缩和清理旧文件交给一个低优先级线程, 写路径不等待
+template <typename P>
+class BasicRotatingFileSink final : public Sink {
+public:
+    explicit BasicRotatingFileSink(const std::string &filename, RotatingFileOptions options = {}, P layout = {})
+    : path_(filename),
+      options_(options),
+      layout_(std::move(layout)),
+      timestamp_(options.precision) {
+        open();
+        std::error_code ec;
+        size_ = static_cast<std::size_t>(std::filesystem::file_size(path_, ec));
+        if (ec) {
+            size_ = 0;
+        }
+        index_ = last_index();
+        boundary_ = next_boundary(std::chrono::system_clock::now());
+        background_.post([] {
+            lower_priority();
+        });
+    }
+
+    void write(const Record &record) override {
+        write_batch({&record, 1});
+    }
+
+    void write_batch(std::span<const Record> records) override {
+        std::scoped_lock lock(mutex_);
+        buffer_.clear();
+        for (const auto &record : records) {
+            const auto mark = buffer_.size();
+            layout_.render(buffer_, record, timestamp_, false);
+            buffer_.push_back('\n');
+            const auto n = buffer_.size() - mark;
+            if (should_rotate(record, n)) {
+                file_.write(buffer_.data(), static_cast<std::streamsize>(mark));
+                buffer_.erase(0, mark);
+                rotate();
+            }
+            size_ += n;
+        }
+        file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    }
+
+    void flush() override {
+        std::scoped_lock lock(mutex_);
+        file_.flush();
+    }
+
+    // 阻塞直到已排队的压缩和清理完成
+    void wait_background() {
+        background_.wait();
+    }
+
+    // 最近一个历史文件的序号, 尚未轮转过为 0
+    std::size_t index() const {
+        std::scoped_lock lock(mutex_);
+        return index_;
+    }
+
+private:
+    void open() {
+        file_.open(path_, std::ios::app | std::ios::binary);
+        if (!file_.is_open()) {
+            throw std::runtime_error("Failed to open log file: " + path_.string());
+        }
+    }
+
+    // 跨过时间边界时顺带推进边界, 当前文件为空则不必换
+    bool should_rotate(const Record &record, std::size_t n) {
+        if (record.time >= boundary_) {
+            boundary_ = next_boundary(record.time);
+            return size_ != 0;
+        }
+        return options_.max_size != 0 && size_ != 0 && size_ + n > options_.max_size;
+    }
+
+    void rotate() {
+        file_.close();
+        const auto target = segment(path_, ++index_);
+        std::error_code ec;
+        std::filesystem::rename(path_, target, ec);
+        open(); // 改名失败时继续追加原文件, 不能让后台线程抛异常
+        size_ = 0;
+        background_.post([target, index = index_, path = path_, options = options_] {
+            if (options.compress && lz::compress(target.string())) {
+                std::filesystem::remove(target, ec_ignored());
+            }
+            if (options.max_files != 0) {
+                // 从超出保留数的序号往前删, 直到遇到已不存在的文件
+                for (auto k = index; k > options.max_files; --k) {
+                    const auto old = segment(path, k - options.max_files);
+                    const auto packed = std::filesystem::path(old.string() + std::string(lz::extension));
+                    const bool removed = std::filesystem::remove(old, ec_ignored());
+                    if (!std::filesystem::remove(packed, ec_ignored()) && !removed) {
+                        break;
+                    }
+                }
+            }
+        });
+    }
+
+    std::chrono::system_clock::time_point next_boundary(std::chrono::system_clock::time_point now) const {
+        using namespace std::chrono;
+        switch (options_.rotation) {
+            case Rotation::Hourly:
+                return floor<hours>(now) + hours(1);
+            case Rotation::Daily:
+                return floor<days>(now) + days(1);
+            default:
+                return system_clock::time_point::max();
+        }
+    }
+
+    // 已有历史文件中的最大序号, 重启后接着编号
+    std::size_t last_index() const {
+        std::size_t last = 0;
+        std::error_code ec;
+        const auto prefix = path_.filename().string() + ".";
+        const auto dir = path_.has_parent_path() ? path_.parent_path() : std::filesystem::path(".");
+        for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+            const auto name = entry.path().filename().string();
+            if (!name.starts_with(prefix)) {
+                continue;
+            }
+            std::size_t k = 0;
+            const auto *begin = name.data() + prefix.size();
+            const auto [end, err] = std::from_chars(begin, name.data() + name.size(), k);
+            if (err == std::errc{} && end != begin && (end == name.data() + name.size() || *end == '.')) {
+                last = std::max(last, k);
+            }
+        }
+        return last;
+    }
+
+    static std::filesystem::path segment(const std::filesystem::path &path, std::size_t index) {
+        return path.string() + "." + std::to_string(index);
+    }
+
+    static std::error_code &ec_ignored() {
+        thread_local std::error_code ec;
+        return ec;
+    }
+
+    // 压缩线程降到最低优先级, 与日志写出和业务线程争用 CPU 时让步
+    static void lower_priority() {
+#if defined(__linux__)
+        ::setpriority(PRIO_PROCESS, 0, 19); // Linux 上 nice 值按线程生效
+#elif defined(_WIN32)
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#endif
+    }
+
+    std::filesystem::path path_;
+    RotatingFileOptions options_;
+    P layout_;
+    TimestampCache timestamp_;
+    std::ofstream file_;
+    std::string buffer_;
+    std::size_t size_ = 0;  // 当前文件已写入的字节数
+    std::size_t index_ = 0; // 最近一个历史文件的序号
+    std::chrono::system_clock::time_point boundary_;
+    mutable std::mutex mutex_;
+    SinkWorker background_; // 最后声明, 析构时先等压缩和清理完成
+};
+
+using RotatingFileSink = BasicRotatingFileSink<FilePattern>;
+} // namespace huxint
@@ -1,33 +1,114 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
+#include <cstdio>
 #include <fstream>
-#include <print>
-#include <format>
+#include <functional>
+#include <span>
 #include <stdexcept>
-#include <chrono>
+#include <type_traits>
+#include <utility>
 #include <mutex>
+#include "crash.hpp"
 #include "level.hpp"
-#include "util.hpp"
+#include "pattern.hpp"
+#include "record.hpp"
+#include "timestamp.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#include <climits>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <io.h>
+#endif
 
 namespace huxint {
+// sink 过滤谓词看到的调用处信息. 在调用线程入队前判断, 此时还没有消息文本
+struct SinkSite {
+    Level level;
+    std::string_view name;
+    std::string_view file;
+    std::uint32_t line;
+};
+
+// 返回 false 时这条日志不交给该 sink, 见 LoggerState::add_sink. 每次调用都会执行, 应当足够便宜
+using SinkFilter = std::function<bool(const SinkSite &)>;
+
 // 虚基类，用于运行时多态
 class Sink {
 public:
     virtual ~Sink() = default;
-    virtual void write(Level level,
-                       std::string_view name,
-                       const std::string &msg,
-                       std::string_view file = "",
-                       std::uint32_t line = 0) = 0;
+    virtual void write(const Record &record) = 0;
+
+    // 后台线程一次交给 sink 的一批记录, 默认逐条 write
+    virtual void write_batch(std::span<const Record> records) {
+        for (const auto &record : records) {
+            write(record);
+        }
+    }
+
     virtual void flush() = 0;
+
+    // 写到持久存储, 用于 Fatal 直写 (见 Logger::set_fatal_write_through). 默认等同 flush
+    virtual void sync() {
+        flush();
+    }
+
+    // 崩溃处理中调用 (见 crash.hpp): 不能加锁或分配内存, 只能用异步信号安全的系统调用.
+    // 不支持时返回 false, 该条改写到崩溃处理的 fd
+    virtual bool crash_write(const Record &) {
+        return false;
+    }
+
+    // 是否需要格式化好的 Record::msg. 只读 format/args 的 sink 返回 false, 可省去后台格式化
+    virtual bool needs_text() const {
+        return true;
+    }
 };
 
-// 控制台输出
-template <bool Color = true>
+namespace detail {
+// 不超过这个大小的 write(2) 写管道时不会与其他写者交错
+#ifdef PIPE_BUF
+inline constexpr std::size_t atomic_write_size = PIPE_BUF;
+#else
+inline constexpr std::size_t atomic_write_size = 4096;
+#endif
+
+inline bool is_terminal(int fd) {
+#if defined(__unix__) || defined(__APPLE__)
+    return ::isatty(fd) != 0;
+#elif defined(_WIN32)
+    return ::_isatty(fd) != 0;
+#else
+    return false;
+#endif
+}
+
+inline bool is_regular_file(int fd) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat st{};
+    return ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+#else
+    return false;
+#endif
+}
+} // namespace detail
+
+// 控制台输出, P 为编译期 Pattern 或运行期 Layout. 不经过 stdio, 整批渲染到自己的缓冲后直接 write(2) 到 fd:
+// 终端上每批立即写出; 重定向时不输出颜色, 攒到 max_buffered 或 flush 时才写. 写管道时在行边界按 PIPE_BUF 分组,
+// 每组一次 write, 与其他进程或 stdio 的输出不会在行内交错; 写普通文件时整块一次写出
+template <bool Color = true, typename P = std::conditional_t<Color, ColorConsolePattern, ConsolePattern>>
 class ConsoleSink final : public Sink {
 public:
-    explicit ConsoleSink() {
+    static constexpr std::size_t max_buffered = 64 * 1024;
+
+    explicit ConsoleSink(P layout = {}, int fd = 1)
+    : layout_(std::move(layout)),
+      fd_(fd),
+      tty_(detail::is_terminal(fd)),
+      group_(detail::is_regular_file(fd) ? SIZE_MAX : detail::atomic_write_size) {
 #ifdef _WIN32
         if constexpr (Color) {
             const HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -38,100 +119,101 @@ public:
 #endif
     }
 
-    void write(Level level,
-               std::string_view name,
-               const std::string &msg,
-               std::string_view file = "",
-               std::uint32_t line = 0) override {
+    ConsoleSink(const ConsoleSink &) = delete;
+    ConsoleSink &operator=(const ConsoleSink &) = delete;
+
+    ~ConsoleSink() override {
+        drain();
+    }
+
+    void write(const Record &record) override {
+        write_batch({&record, 1});
+    }
+
+    // 每批结束时写出, 低流量的输出不会停在缓冲里; 一批超过 max_buffered 时中途先写出一部分
+    void write_batch(std::span<const Record> records) override {
         std::scoped_lock lock(mutex_);
-        if constexpr (Color) {
-            if (name.empty()) {
-                if (file.empty()) {
-                    std::println("{}[{:>5}]{} {}", color_code(level), to_string(level), reset_code(), msg);
-                } else {
-                    std::println("{}[{:>5}]{} {}{}:{}{} {}",
-                                 color_code(level),
-                                 to_string(level),
-                                 reset_code(),
-                                 "\033[32m",
-                                 file,
-                                 line,
-                                 reset_code(),
-                                 msg);
-                }
-            } else {
-                if (file.empty()) {
-                    std::println("{}[{:>5}]<{}>{} {}", color_code(level), to_string(level), name, reset_code(), msg);
-                } else {
-                    std::println("{}[{:>5}]<{}>{} {}{}:{}{} {}",
-                                 color_code(level),
-                                 to_string(level),
-                                 name,
-                                 reset_code(),
-                                 "\033[32m",
-                                 file,
-                                 line,
-                                 reset_code(),
-                                 msg);
-                }
-            }
-        } else {
-            if (name.empty()) {
-                if (file.empty()) {
-                    std::println("[{:>5}] {}", to_string(level), msg);
-                } else {
-                    std::println("[{:>5}] {}:{} {}", to_string(level), file, line, msg);
-                }
-            } else {
-                if (file.empty()) {
-                    std::println("[{:>5}]<{}> {}", to_string(level), name, msg);
-                } else {
-                    std::println("[{:>5}]<{}> {}:{} {}", to_string(level), name, file, line, msg);
-                }
+        for (const auto &record : records) {
+            layout_.render(buffer_, record, timestamp_, Color && tty_);
+            buffer_.push_back('\n');
+            if (buffer_.size() >= max_buffered) {
+                drain();
             }
         }
+        drain();
     }
 
     void flush() override {
         std::scoped_lock lock(mutex_);
-        std::fflush(stdout);
+        drain();
+    }
+
+    // 不加锁: 先写出缓冲中已有的行 (崩溃发生在一批中途时), 再直接写这一行
+    bool crash_write(const Record &record) override {
+        if (!buffer_.empty()) {
+            detail::write_fd(fd_, buffer_);
+            buffer_.clear();
+        }
+        char line[2048];
+        TimestampCache timestamp;
+        detail::write_fd(fd_, detail::render_bounded(line, record, layout_, timestamp, Color && tty_));
+        return true;
     }
 
 private:
+    // 在行边界切成不超过 group_ 的段, 每段一次写出. 单行超过 group_ 时整行单独写
+    void drain() {
+        std::string_view rest = buffer_;
+        while (!rest.empty()) {
+            auto n = rest.size();
+            if (n > group_) {
+                n = rest.rfind('\n', group_ - 1) + 1;
+                if (n == 0) {
+                    const auto end = rest.find('\n');
+                    n = end == std::string_view::npos ? rest.size() : end + 1;
+                }
+            }
+            detail::write_fd(fd_, rest.substr(0, n));
+            rest.remove_prefix(n);
+        }
+        buffer_.clear();
+    }
+
+    P layout_;
+    const int fd_;
+    const bool tty_;          // 终端上带颜色
+    const std::size_t group_; // 一次 write 的上限, 普通文件不限
+    TimestampCache timestamp_;
+    std::string buffer_;
     std::mutex mutex_;
 };
 
-// 文件输出
-class FileSink final : public Sink {
+// 文件输出, P 为编译期 Pattern 或运行期 Layout
+template <typename P>
+class BasicFileSink final : public Sink {
 public:
-    explicit FileSink(const std::string &filename)
-    : file_(filename, std::ios::app) {
+    explicit BasicFileSink(const std::string &filename, Precision precision = Precision::Seconds, P layout = {})
+    : file_(filename, std::ios::app),
+      layout_(std::move(layout)),
+      timestamp_(precision) {
         if (!file_.is_open()) {
             throw std::runtime_error("Failed to open log file: " + filename);
         }
     }
 
-    void write(Level level,
-               std::string_view name,
-               const std::string &msg,
-               std::string_view file = "",
-               std::uint32_t line = 0) override {
+    void write(const Record &record) override {
+        write_batch({&record, 1});
+    }
+
+    // 整批格式化到一块缓冲区后一次写出
+    void write_batch(std::span<const Record> records) override {
         std::scoped_lock lock(mutex_);
-        auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now());
-        if (name.empty()) {
-            if (file.empty()) {
-                file_ << std::format("[time: {:%F %T}][{:>5}] {}\n", now, to_string(level), msg);
-            } else {
-                file_ << std::format("[time: {:%F %T}][{:>5}] {}:{} {}\n", now, to_string(level), file, line, msg);
-            }
-        } else {
-            if (file.empty()) {
-                file_ << std::format("[time: {:%F %T}][{:>5}]<{}> {}\n", now, to_string(level), name, msg);
-            } else {
-                file_ << std::format(
-                    "[time: {:%F %T}][{:>5}]<{}> {}:{} {}\n", now, to_string(level), name, file, line, msg);
-            }
+        buffer_.clear();
+        for (const auto &record : records) {
+            layout_.render(buffer_, record, timestamp_, false);
+            buffer_.push_back('\n');
         }
+        file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
     }
 
     void flush() override {
@@ -141,6 +223,11 @@ public:
 
 private:
     std::ofstream file_;
+    P layout_;
+    TimestampCache timestamp_;
+    std::string buffer_;
     std::mutex mutex_;
 };
+
+using FileSink = BasicFileSink<FilePattern>;
 } // namespace huxint
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+namespace huxint {
+// 时间戳的小数秒精度
+enum class Precision : std::uint8_t { Seconds, Millis, Micros, Nanos };
+
+// UTC 时间戳格式化 "YYYY-MM-DD HH:MM:SS[.fff...]".
+// 缓存当前分钟的 "YYYY-MM-DD HH:MM:" 前缀, 同一分钟内每条记录只补写秒和小数部分, 不经过 chrono 格式化
+class TimestampCache {
+public:
+    static constexpr std::size_t max_size = 29;
+
+    explicit TimestampCache(Precision precision = Precision::Seconds)
+    : precision_(precision) {}
+
+    // 返回的 string_view 在下一次调用前有效
+    std::string_view format(std::chrono::system_clock::time_point time) {
+        using namespace std::chrono;
+        const auto ns = duration_cast<nanoseconds>(time.time_since_epoch()).count();
+        constexpr std::int64_t ns_per_minute = 60'000'000'000;
+        auto minute = ns / ns_per_minute;
+        auto rest = ns % ns_per_minute;
+        if (rest < 0) {
+            --minute;
+            rest += ns_per_minute;
+        }
+        if (minute != minute_) {
+            minute_ = minute;
+            fill_prefix(sys_time<minutes>(minutes(minute)));
+        }
+        put(buffer_ + 17, static_cast<std::uint32_t>(rest / 1'000'000'000), 2);
+        const auto digits = fraction_digits();
+        if (digits == 0) {
+            return {buffer_, 19};
+        }
+        buffer_[19] = '.';
+        auto fraction = static_cast<std::uint32_t>(rest % 1'000'000'000);
+        for (auto i = digits; i < 9; ++i) {
+            fraction /= 10;
+        }
+        put(buffer_ + 20, fraction, digits);
+        return {buffer_, 20 + digits};
+    }
+
+    Precision precision() const {
+        return precision_;
+    }
+
+private:
+    std::size_t fraction_digits() const {
+        switch (precision_) {
+            case Precision::Millis:
+                return 3;
+            case Precision::Micros:
+                return 6;
+            case Precision::Nanos:
+                return 9;
+            default:
+                return 0;
+        }
+    }
+
+    void fill_prefix(std::chrono::sys_time<std::chrono::minutes> time) {
+        using namespace std::chrono;
+        const auto day = floor<days>(time);
+        const year_month_day ymd{day};
+        const hh_mm_ss hms{time - day};
+        put(buffer_, static_cast<std::uint32_t>(static_cast<int>(ymd.year())), 4);
+        buffer_[4] = '-';
+        put(buffer_ + 5, static_cast<unsigned>(ymd.month()), 2);
+        buffer_[7] = '-';
+        put(buffer_ + 8, static_cast<unsigned>(ymd.day()), 2);
+        buffer_[10] = ' ';
+        put(buffer_ + 11, static_cast<std::uint32_t>(hms.hours().count()), 2);
+        buffer_[13] = ':';
+        put(buffer_ + 14, static_cast<std::uint32_t>(hms.minutes().count()), 2);
+        buffer_[16] = ':';
+    }
+
+    static void put(char *out, std::uint32_t value, std::size_t width) {
+        for (auto i = width; i > 0; --i) {
+            out[i - 1] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+
+    Precision precision_;
+    std::int64_t minute_ = std::numeric_limits<std::int64_t>::min();
+    char buffer_[max_size]{};
+};
+} // namespace huxint
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace huxint {
+// sink 工作线程: 任务按提交顺序串行执行, 队列有上限, 满时提交方阻塞, 使背压传回生产者队列.
+// 队列是预先分配的环形数组, 任务装得进 std::function 的内部存储时提交不分配
+class SinkWorker {
+public:
+    using Task = std::function<void()>;
+
+    explicit SinkWorker(std::size_t capacity = 64)
+    : tasks_(capacity),
+      thread_([this](std::stop_token token) {
+          run(token);
+      }) {}
+
+    SinkWorker(const SinkWorker &) = delete;
+    SinkWorker &operator=(const SinkWorker &) = delete;
+
+    // 先执行完已提交的任务再退出
+    ~SinkWorker() {
+        wait();
+        {
+            std::scoped_lock lock(mutex_);
+            thread_.request_stop();
+        }
+        ready_.notify_one();
+    }
+
+    void post(Task task) {
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [&] {
+            return size_ < tasks_.size();
+        });
+        tasks_[(head_ + size_) % tasks_.size()] = std::move(task);
+        ++size_;
+        ready_.notify_one();
+    }
+
+    // 阻塞直到已提交的任务全部执行完
+    void wait() {
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [&] {
+            return size_ == 0 && !busy_;
+        });
+    }
+
+private:
+    void run(const std::stop_token &token) {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            ready_.wait(lock, [&] {
+                return size_ != 0 || token.stop_requested();
+            });
+            if (size_ == 0) {
+                return;
+            }
+            auto task = std::move(tasks_[head_]);
+            tasks_[head_] = nullptr;
+            head_ = (head_ + 1) % tasks_.size();
+            --size_;
+            busy_ = true;
+            lock.unlock();
+            idle_.notify_all();
+            task();
+            lock.lock();
+            busy_ = false;
+            idle_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable idle_;
+    std::vector<Task> tasks_; // 环形数组, 从 head_ 起的 size_ 个
+    std::size_t head_ = 0;
+    std::size_t size_ = 0;
+    bool busy_ = false;
+
+    std::jthread thread_; // 最后声明, 保证其余成员先构造后析构
+};
+} // namespace huxint
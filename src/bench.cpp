@@ -0,0 +1,693 @@
+#include <huxint/logger.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <latch>
+#include <new>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <variant>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace huxint;
+
+// 统计堆分配次数: 进程总数和当前线程的次数
+static std::atomic<std::size_t> total_allocations{0};
+thread_local std::size_t thread_allocations = 0;
+
+void *operator new(std::size_t size) {
+    total_allocations.fetch_add(1, std::memory_order_relaxed);
+    ++thread_allocations;
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// 一行结果, 按列名存放, 不适用的列留空
+class Result {
+public:
+    using Value = std::variant<std::string, std::size_t, double>;
+
+    Result &set(std::string_view key, Value value) {
+        fields_.emplace_back(key, std::move(value));
+        return *this;
+    }
+
+    const Value *get(std::string_view key) const {
+        const auto it = std::ranges::find(fields_, key, &std::pair<std::string_view, Value>::first);
+        return it == fields_.end() ? nullptr : &it->second;
+    }
+
+    const auto &fields() const {
+        return fields_;
+    }
+
+private:
+    std::vector<std::pair<std::string_view, Value>> fields_;
+};
+
+constexpr std::string_view columns[] = {"suite",   "case",    "threads",  "api",     "args",    "sink",
+                                        "sinks",   "workers", "metrics", "overflow", "thread", "role",
+                                        "calls",    "seconds", "calls_per_sec", "ns_per_call",
+                                        "p50_ns",  "p99_ns",  "p999_ns",  "max_ns",  "dropped", "alloc_per_call",
+                                        "backend_alloc_per_call", "mb_per_sec", "syscalls_per_100k"};
+
+std::string to_text(const Result::Value &value, bool json) {
+    return std::visit(
+        [&]<typename T>(const T &v) {
+            if (json) {
+                // 与 JsonSink 相同的转义, nan/inf 输出为 null
+                std::string out;
+                if constexpr (std::same_as<T, std::string>) {
+                    huxint::json::put_string(out, v);
+                } else {
+                    huxint::json::put_number(out, v);
+                }
+                return out;
+            }
+            if constexpr (std::same_as<T, std::string>) {
+                // CSV 按 RFC 4180 给字符串加引号, 内部的引号写两遍, 名字中的逗号和引号不会拆开一行
+                std::string out = "\"";
+                for (const char c : v) {
+                    if (c == '"') {
+                        out += '"';
+                    }
+                    out += c;
+                }
+                out += '"';
+                return out;
+            } else if constexpr (std::same_as<T, double>) {
+                return std::format("{:.6g}", v);
+            } else {
+                return std::format("{}", v);
+            }
+        },
+        value);
+}
+
+void print_csv(std::FILE *out, const std::vector<Result> &results) {
+    std::string line;
+    for (const auto column : columns) {
+        line += line.empty() ? "" : ",";
+        line += column;
+    }
+    std::println(out, "{}", line);
+    for (const auto &result : results) {
+        line.clear();
+        for (std::size_t i = 0; i < std::size(columns); ++i) {
+            line += i == 0 ? "" : ",";
+            if (const auto *value = result.get(columns[i])) {
+                line += to_text(*value, false);
+            }
+        }
+        std::println(out, "{}", line);
+    }
+}
+
+void print_json(std::FILE *out, const std::vector<Result> &results) {
+    std::println(out, "[");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        std::string line = "  {";
+        for (const auto &[key, value] : results[i].fields()) {
+            line += line.size() == 3 ? "" : ", ";
+            huxint::json::put_string(line, key);
+            line += ": " + to_text(value, true);
+        }
+        line += i + 1 == results.size() ? "}" : "},";
+        std::println(out, "{}", line);
+    }
+    std::println(out, "]");
+}
+
+// 本进程累计的 write 类系统调用次数 (Linux /proc/self/io 的 syscw)
+std::size_t write_syscalls() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    std::size_t value = 0;
+    while (io >> key >> value) {
+        if (key == "syscw:") {
+            return value;
+        }
+    }
+    return 0;
+}
+
+std::filesystem::path bench_path(std::string_view name) {
+    auto path = std::filesystem::temp_directory_path() / std::format("huxint_bench_{}.log", name);
+    std::filesystem::remove(path);
+    return path;
+}
+
+// 单线程写 lines 行后 flush, 统计吞吐和系统调用次数
+template <typename L>
+Result bench_file_sink(std::string_view label, const std::filesystem::path &path, std::size_t lines) {
+    const auto syscalls = write_syscalls();
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < lines; ++i) {
+        L::info_raw("bench line {} value {} status {}", i, i * 3, "ok");
+    }
+    L::flush();
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto calls = write_syscalls() - syscalls;
+    const auto bytes = std::filesystem::file_size(path);
+
+    return Result{}
+        .set("suite", "file_sink")
+        .set("case", std::string(label))
+        .set("calls", lines)
+        .set("seconds", seconds)
+        .set("calls_per_sec", static_cast<double>(lines) / seconds)
+        .set("mb_per_sec", static_cast<double>(bytes) / seconds / 1e6)
+        .set("syscalls_per_100k", static_cast<double>(calls) * 100000.0 / static_cast<double>(lines));
+}
+
+template <String Name>
+Result bench_posix(std::size_t buffer_size, std::size_t lines) {
+    using L = Logger<Name>;
+    const auto path = bench_path(Name.str());
+    L::template add_sink<PosixFileSink>(path.string(), PosixFileOptions{.buffer_size = buffer_size});
+    return bench_file_sink<L>(std::format("PosixFileSink ({} KiB)", buffer_size / 1024), path, lines);
+}
+
+// 原先按 name/file 是否为空分四个分支的 std::format_to 写法, 作为布局引擎的对照
+void branch_format(std::string &out, const Record &record, std::string_view now) {
+    const auto &[level, name, msg, file, line] = std::tie(record.level, record.name, record.msg, record.file, record.line);
+    auto it = std::back_inserter(out);
+    if (name.empty()) {
+        if (file.empty()) {
+            std::format_to(it, "[time: {}][{:>5}] {}", now, to_string(level), msg);
+        } else {
+            std::format_to(it, "[time: {}][{:>5}] {}:{} {}", now, to_string(level), file, line, msg);
+        }
+    } else {
+        if (file.empty()) {
+            std::format_to(it, "[time: {}][{:>5}]<{}> {}", now, to_string(level), name, msg);
+        } else {
+            std::format_to(it, "[time: {}][{:>5}]<{}> {}:{} {}", now, to_string(level), name, file, line, msg);
+        }
+    }
+}
+
+// 只测一行的格式化 (不含入队和写出)
+template <typename F>
+Result bench_layout(std::string_view label, std::size_t lines, F &&render) {
+    const Record records[] = {
+        {Level::Info, "bench", "request handled in 12 ms", "src/server.cpp", 128, std::chrono::system_clock::now()},
+        {Level::Warn, "", "cache miss ratio above threshold", "", 0, std::chrono::system_clock::now()},
+    };
+    std::string out;
+    std::size_t bytes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < lines; ++i) {
+        out.clear();
+        render(out, records[i & 1]);
+        bytes += out.size();
+    }
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (bytes == 0) {
+        std::abort(); // 防止渲染被优化掉
+    }
+    return Result{}
+        .set("suite", "layout")
+        .set("case", std::string(label))
+        .set("calls", lines)
+        .set("seconds", seconds)
+        .set("calls_per_sec", static_cast<double>(lines) / seconds)
+        .set("ns_per_call", seconds * 1e9 / static_cast<double>(lines));
+}
+
+// 调用方矩阵: 生产者线程数, info/info_raw, 参数个数, sink 种类与个数, sink 工作线程数
+enum class SinkKind : std::uint8_t { Null, File, Console };
+
+constexpr std::string_view to_string(SinkKind kind) {
+    switch (kind) {
+        case SinkKind::File:
+            return "file";
+        case SinkKind::Console:
+            return "console";
+        default:
+            return "null";
+    }
+}
+
+// 只计数, 不格式化也不写出, 测的是前端和后台分发本身
+class NullSink final : public Sink {
+public:
+    void write(const Record &) override {}
+
+    void write_batch(std::span<const Record> records) override {
+        count_ += records.size();
+    }
+
+    void flush() override {}
+
+private:
+    std::size_t count_ = 0;
+};
+
+struct Case {
+    std::size_t threads = 1;
+    bool location = false; // info 还是 info_raw
+    std::size_t args = 2;
+    SinkKind sink = SinkKind::Null;
+    std::size_t sinks = 1;
+    std::size_t workers = 1;
+    bool metrics = false; // set_metrics(true), 统计延迟和 sink 耗时
+};
+
+using BenchLogger = Logger<"bench">;
+
+template <bool Location, std::size_t Args>
+void log_call(std::size_t i) {
+    using L = BenchLogger;
+    if constexpr (Args == 0) {
+        if constexpr (Location) {
+            L::info("request handled without arguments");
+        } else {
+            L::info_raw("request handled without arguments");
+        }
+    } else if constexpr (Args == 2) {
+        if constexpr (Location) {
+            L::info("request {} status {}", i, "ok");
+        } else {
+            L::info_raw("request {} status {}", i, "ok");
+        }
+    } else {
+        if constexpr (Location) {
+            L::info("a={} b={} c={} d={} e={} f={} g={} h={}", i, i + 1, 2.5, "str", true, 'c', 3u, -7LL);
+        } else {
+            L::info_raw("a={} b={} c={} d={} e={} f={} g={} h={}", i, i + 1, 2.5, "str", true, 'c', 3u, -7LL);
+        }
+    }
+}
+
+using CallFn = void (*)(std::size_t);
+
+CallFn call_of(const Case &c) {
+    constexpr CallFn table[2][3] = {{&log_call<false, 0>, &log_call<false, 2>, &log_call<false, 8>},
+                                    {&log_call<true, 0>, &log_call<true, 2>, &log_call<true, 8>}};
+    return table[c.location][c.args == 0 ? 0 : c.args == 2 ? 1 : 2];
+}
+
+double percentile(std::vector<std::uint32_t> &samples, double p) {
+    const auto k = std::min(samples.size() - 1, static_cast<std::size_t>(p * static_cast<double>(samples.size())));
+    std::ranges::nth_element(samples, samples.begin() + static_cast<std::ptrdiff_t>(k));
+    return samples[k];
+}
+
+// 每个生产者先预热 (注册队列等一次性分配不计入), 同时开始计时, 全部 flush 完成才停表
+Result run_case(const Case &c, std::size_t total_calls) {
+    using L = BenchLogger;
+    L::clear_sinks();
+    L::set_thread_count(c.workers);
+    L::set_metrics(c.metrics);
+    for (std::size_t k = 0; k < c.sinks; ++k) {
+        switch (c.sink) {
+            case SinkKind::File:
+                L::add_sink<FileSink>(bench_path(std::format("matrix{}", k)).string());
+                break;
+            case SinkKind::Console:
+                L::add_sink<ConsoleSink<false>>();
+                break;
+            default:
+                L::add_sink<NullSink>();
+                break;
+        }
+    }
+    const auto call = call_of(c);
+    const auto per_thread = std::max<std::size_t>(total_calls / c.threads, 1000);
+    std::vector<std::vector<std::uint32_t>> latencies(c.threads, std::vector<std::uint32_t>(per_thread));
+    std::atomic<std::size_t> producer_allocations{0};
+    std::latch ready(static_cast<std::ptrdiff_t>(c.threads) + 1);
+    std::latch go(1);
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < c.threads; ++t) {
+        threads.emplace_back([&, t] {
+            for (std::size_t i = 0; i < 100; ++i) {
+                call(i);
+            }
+            ready.arrive_and_wait();
+            go.wait();
+            const auto allocations = thread_allocations;
+            auto &samples = latencies[t];
+            for (std::size_t i = 0; i < per_thread; ++i) {
+                const auto begin = std::chrono::steady_clock::now();
+                call(i);
+                samples[i] = static_cast<std::uint32_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+            }
+            producer_allocations.fetch_add(thread_allocations - allocations, std::memory_order_relaxed);
+        });
+    }
+    ready.arrive_and_wait();
+    L::flush();
+    const auto allocations = total_allocations.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    go.count_down();
+    threads.clear();
+    L::flush();
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto backend_allocations = total_allocations.load(std::memory_order_relaxed) - allocations -
+                                     producer_allocations.load(std::memory_order_relaxed);
+
+    std::vector<std::uint32_t> samples;
+    samples.reserve(per_thread * c.threads);
+    for (const auto &v : latencies) {
+        samples.insert(samples.end(), v.begin(), v.end());
+    }
+    const auto calls = samples.size();
+    const auto max = *std::ranges::max_element(samples);
+    return Result{}
+        .set("suite", "logging")
+        .set("threads", c.threads)
+        .set("api", c.location ? "info" : "info_raw")
+        .set("args", c.args)
+        .set("sink", std::string(to_string(c.sink)))
+        .set("sinks", c.sinks)
+        .set("workers", c.workers)
+        .set("metrics", std::string(c.metrics ? "on" : "off"))
+        .set("calls", calls)
+        .set("seconds", seconds)
+        .set("calls_per_sec", static_cast<double>(calls) / seconds)
+        .set("p50_ns", percentile(samples, 0.5))
+        .set("p99_ns", percentile(samples, 0.99))
+        .set("p999_ns", percentile(samples, 0.999))
+        .set("max_ns", static_cast<double>(max))
+        .set("alloc_per_call",
+             static_cast<double>(producer_allocations.load(std::memory_order_relaxed)) / static_cast<double>(calls))
+        .set("backend_alloc_per_call", static_cast<double>(backend_allocations) / static_cast<double>(calls));
+}
+
+// 默认从基准配置出发每次只改一个维度; full 时跑完整的笛卡尔积
+std::vector<Case> logging_cases(bool full) {
+    constexpr std::size_t thread_counts[] = {1, 2, 4, 8, 16, 32, 64};
+    constexpr std::size_t arg_counts[] = {0, 2, 8};
+    constexpr SinkKind kinds[] = {SinkKind::Null, SinkKind::File, SinkKind::Console};
+    constexpr std::size_t worker_counts[] = {1, 2, 4, 8};
+    std::vector<Case> cases;
+    if (full) {
+        for (auto threads : thread_counts) {
+            for (bool location : {false, true}) {
+                for (auto args : arg_counts) {
+                    for (auto sink : kinds) {
+                        for (auto workers : worker_counts) {
+                            cases.push_back({threads, location, args, sink, workers, workers});
+                        }
+                    }
+                }
+            }
+        }
+        return cases;
+    }
+    for (auto sink : {SinkKind::Null, SinkKind::File}) {
+        for (auto threads : thread_counts) {
+            cases.push_back({.threads = threads, .sink = sink});
+        }
+    }
+    for (bool location : {false, true}) {
+        for (auto args : arg_counts) {
+            cases.push_back({.location = location, .args = args});
+        }
+    }
+    for (auto threads : {std::size_t{1}, std::size_t{4}}) {
+        for (auto sink : kinds) {
+            cases.push_back({.threads = threads, .sink = sink});
+        }
+    }
+    // 开启指标统计的开销
+    for (auto threads : {std::size_t{1}, std::size_t{4}}) {
+        for (auto sink : {SinkKind::Null, SinkKind::File}) {
+            cases.push_back({.threads = threads, .sink = sink, .metrics = true});
+        }
+    }
+    // 工作线程数与 sink 个数相同, 每个工作线程分到一个文件
+    for (auto workers : worker_counts) {
+        cases.push_back({.threads = 4, .sink = SinkKind::File, .sinks = workers, .workers = workers});
+    }
+    return cases;
+}
+
+// 生产者争用: 每个线程绑定到一个核上连续写日志, 按线程给出单次调用延迟的分位数和最大值.
+// noisy 时第 0 个线程改写另一个 logger, 其 sink 每批都很慢, 看其余线程是否被它拖住
+struct ContentionCase {
+    std::size_t threads = 4;
+    Overflow overflow = Overflow::DropNewest;
+    bool noisy = false;
+};
+
+constexpr std::string_view to_string(Overflow overflow) {
+    switch (overflow) {
+        case Overflow::DropNewest:
+            return "drop_newest";
+        case Overflow::DropOldest:
+            return "drop_oldest";
+        default:
+            return "block";
+    }
+}
+
+// 把当前线程绑定到第 cpu 个核 (按核数取模), 只在 Linux 上生效
+void pin_to_core(std::size_t cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % std::max(1U, std::thread::hardware_concurrency()), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+// 每批都要花一段时间, 模拟卡顿的磁盘或网络
+class SlowSink final : public Sink {
+public:
+    void write(const Record &) override {}
+
+    void write_batch(std::span<const Record>) override {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    void flush() override {}
+};
+
+using CriticalLogger = Logger<"critical">;
+using NoisyLogger = Logger<"noisy">;
+
+std::vector<Result> run_contention(const ContentionCase &c, std::size_t per_thread) {
+    for (auto *state : {&CriticalLogger::state(), &NoisyLogger::state()}) {
+        state->clear_sinks();
+        state->set_overflow(c.overflow);
+    }
+    CriticalLogger::add_sink<NullSink>();
+    NoisyLogger::add_sink<SlowSink>();
+    const auto dropped = CriticalLogger::dropped() + NoisyLogger::dropped();
+
+    std::vector<std::vector<std::uint32_t>> latencies(c.threads, std::vector<std::uint32_t>(per_thread));
+    std::latch ready(static_cast<std::ptrdiff_t>(c.threads) + 1);
+    std::latch go(1);
+    std::vector<std::jthread> threads;
+    for (std::size_t t = 0; t < c.threads; ++t) {
+        threads.emplace_back([&, t] {
+            pin_to_core(t);
+            const bool noisy = c.noisy && t == 0;
+            auto call = [noisy](std::size_t i) {
+                if (noisy) {
+                    NoisyLogger::info_raw("noisy {} status {}", i, "ok");
+                } else {
+                    CriticalLogger::info_raw("request {} status {}", i, "ok");
+                }
+            };
+            for (std::size_t i = 0; i < 100; ++i) {
+                call(i);
+            }
+            ready.arrive_and_wait();
+            go.wait();
+            auto &samples = latencies[t];
+            for (std::size_t i = 0; i < per_thread; ++i) {
+                const auto begin = std::chrono::steady_clock::now();
+                call(i);
+                samples[i] = static_cast<std::uint32_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+            }
+        });
+    }
+    ready.arrive_and_wait();
+    CriticalLogger::flush();
+    const auto start = std::chrono::steady_clock::now();
+    go.count_down();
+    threads.clear();
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    CriticalLogger::flush();
+    const auto lost = CriticalLogger::dropped() + NoisyLogger::dropped() - dropped;
+
+    std::vector<Result> results;
+    for (std::size_t t = 0; t < c.threads; ++t) {
+        auto &samples = latencies[t];
+        const auto max = *std::ranges::max_element(samples);
+        results.push_back(Result{}
+                              .set("suite", "contention")
+                              .set("case", std::string(c.noisy ? "noisy" : "uniform"))
+                              .set("threads", c.threads)
+                              .set("overflow", std::string(to_string(c.overflow)))
+                              .set("thread", t)
+                              .set("role", std::string(c.noisy && t == 0 ? "noisy" : "critical"))
+                              .set("calls", per_thread)
+                              .set("seconds", seconds)
+                              .set("p50_ns", percentile(samples, 0.5))
+                              .set("p99_ns", percentile(samples, 0.99))
+                              .set("p999_ns", percentile(samples, 0.999))
+                              .set("max_ns", static_cast<double>(max))
+                              .set("dropped", static_cast<std::size_t>(lost)));
+    }
+    return results;
+}
+
+std::vector<ContentionCase> contention_cases(bool full) {
+    std::vector<ContentionCase> cases;
+    const auto thread_counts = full ? std::vector<std::size_t>{1, 2, 4, 8, 16, 32, 64} : std::vector<std::size_t>{2, 4, 8};
+    for (auto overflow : {Overflow::Block, Overflow::DropNewest, Overflow::DropOldest}) {
+        for (auto threads : thread_counts) {
+            cases.push_back({threads, overflow, false});
+        }
+        cases.push_back({4, overflow, true});
+    }
+    return cases;
+}
+
+void usage() {
+    std::println(stderr,
+                 "usage: LoggerBench [options]\n"
+                 "  --format <csv|json>  output format, default csv\n"
+                 "  --suite <name>       only run logging, contention, file_sink or layout\n"
+                 "  --quick              fewer calls per case\n"
+                 "  --full               full cartesian product for logging, more thread counts for contention\n"
+                 "  -o <file>            write results to file instead of stdout");
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    bool quick = false;
+    bool full = false;
+    std::string suite;
+    std::string output;
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const auto &arg = args[i];
+        const bool has_value = i + 1 < args.size();
+        if (arg == "--format" && has_value && (args[i + 1] == "csv" || args[i + 1] == "json")) {
+            json = args[++i] == "json";
+        } else if (arg == "--suite" && has_value) {
+            suite = args[++i];
+        } else if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--full") {
+            full = true;
+        } else if (arg == "-o" && has_value) {
+            output = args[++i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    // ConsoleSink 写到 /dev/null, 结果写到原来的标准输出或 -o 指定的文件
+    std::FILE *out = output.empty() ? ::fdopen(::dup(STDOUT_FILENO), "w") : std::fopen(output.c_str(), "w");
+    if (out == nullptr) {
+        std::println(stderr, "cannot open output");
+        return 1;
+    }
+    std::fflush(stdout);
+    ::dup2(::open("/dev/null", O_WRONLY), STDOUT_FILENO);
+
+    const std::size_t calls = quick ? 20'000 : 200'000;
+    const std::size_t lines = quick ? 100'000 : 1'000'000;
+    std::vector<Result> results;
+    auto wanted = [&](std::string_view name) {
+        return suite.empty() || suite == name;
+    };
+
+    if (wanted("logging")) {
+        const auto cases = logging_cases(full);
+        for (std::size_t i = 0; i < cases.size(); ++i) {
+            std::println(stderr, "[{}/{}] logging", i + 1, cases.size());
+            results.push_back(run_case(cases[i], calls));
+        }
+        BenchLogger::clear_sinks();
+        BenchLogger::set_thread_count(1);
+        BenchLogger::set_metrics(false);
+    }
+
+    if (wanted("contention")) {
+        const auto cases = contention_cases(full);
+        for (std::size_t i = 0; i < cases.size(); ++i) {
+            std::println(stderr, "[{}/{}] contention", i + 1, cases.size());
+            auto rows = run_contention(cases[i], calls / 4);
+            results.insert(results.end(), rows.begin(), rows.end());
+        }
+        for (auto *state : {&CriticalLogger::state(), &NoisyLogger::state()}) {
+            state->clear_sinks();
+            state->set_overflow(Overflow::Block);
+        }
+    }
+
+    if (wanted("file_sink")) {
+        std::println(stderr, "file_sink");
+        {
+            using L = Logger<"FileSink">;
+            const auto path = bench_path("FileSink");
+            L::add_sink<FileSink>(path.string());
+            results.push_back(bench_file_sink<L>("FileSink (std::ofstream)", path, lines));
+        }
+        results.push_back(bench_posix<"Posix64K">(64 * 1024, lines));
+        results.push_back(bench_posix<"Posix1M">(1024 * 1024, lines));
+        results.push_back(bench_posix<"Posix4M">(4 * 1024 * 1024, lines));
+    }
+
+    if (wanted("layout")) {
+        std::println(stderr, "layout");
+        TimestampCache timestamp;
+        results.push_back(bench_layout("std::format branches", lines, [&](std::string &out, const Record &record) {
+            branch_format(out, record, timestamp.format(record.time));
+        }));
+        results.push_back(bench_layout("Pattern (compile time)", lines, [&](std::string &out, const Record &record) {
+            FilePattern{}.render(out, record, timestamp, false);
+        }));
+        const Layout layout(FilePattern::str());
+        results.push_back(bench_layout("Layout (runtime)", lines, [&](std::string &out, const Record &record) {
+            layout.render(out, record, timestamp, false);
+        }));
+    }
+
+    if (json) {
+        print_json(out, results);
+    } else {
+        print_csv(out, results);
+    }
+    std::fclose(out);
+    return 0;
+}
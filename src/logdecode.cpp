@@ -0,0 +1,156 @@
+// huxint-logdecode: 把 BinaryFileSink 写出的二进制日志转回与 FileSink 相同的文本
+#include <huxint/logger/binlog.hpp>
+#include <huxint/logger/pattern.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <print>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace huxint;
+
+namespace {
+void usage() {
+    std::println(stderr,
+                 "usage: huxint-logdecode [options] <file>\n"
+                 "  --level <trace|debug|info|warn|error|fatal>  only records at or above this level\n"
+                 "  --logger <name>                               only records from this logger\n"
+                 "  --since <YYYY-MM-DD[ HH:MM:SS]>               only records at or after this UTC time\n"
+                 "  --until <YYYY-MM-DD[ HH:MM:SS]>               only records at or before this UTC time\n"
+                 "  --precision <s|ms|us|ns>                      timestamp precision, default s\n"
+                 "  -o <file>                                     write to file instead of stdout");
+}
+
+std::optional<Level> parse_level(std::string_view text) {
+    for (auto lv : {Level::Trace, Level::Debug, Level::Info, Level::Warn, Level::Error, Level::Fatal}) {
+        const auto name = to_string(lv);
+        if (text.size() == name.size() && std::equal(text.begin(), text.end(), name.begin(), [](char a, char b) {
+                return (a & ~0x20) == b;
+            })) {
+            return lv;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<Precision> parse_precision(std::string_view text) {
+    if (text == "s") {
+        return Precision::Seconds;
+    }
+    if (text == "ms") {
+        return Precision::Millis;
+    }
+    if (text == "us") {
+        return Precision::Micros;
+    }
+    if (text == "ns") {
+        return Precision::Nanos;
+    }
+    return std::nullopt;
+}
+
+// 与日志中的时间戳一致, 按 UTC 解析
+std::optional<std::chrono::system_clock::time_point> parse_time(const std::string &text) {
+    int y = 0;
+    unsigned mo = 0, d = 0, h = 0, mi = 0, s = 0;
+    const int n = std::sscanf(text.c_str(), "%d-%u-%u%*c%u:%u:%u", &y, &mo, &d, &h, &mi, &s);
+    if (n != 3 && n != 6) {
+        return std::nullopt;
+    }
+    const std::chrono::year_month_day date{std::chrono::year(y), std::chrono::month(mo), std::chrono::day(d)};
+    if (!date.ok() || h > 23 || mi > 59 || s > 60) {
+        return std::nullopt;
+    }
+    return std::chrono::sys_days(date) + std::chrono::hours(h) + std::chrono::minutes(mi) + std::chrono::seconds(s);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    binlog::Filter filter;
+    Precision precision = Precision::Seconds;
+    std::string input;
+    std::string output;
+
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const auto &arg = args[i];
+        const bool has_value = i + 1 < args.size();
+        if (arg == "-h" || arg == "--help") {
+            usage();
+            return 0;
+        }
+        if (arg == "--level" && has_value) {
+            const auto lv = parse_level(args[++i]);
+            if (!lv) {
+                std::println(stderr, "invalid level: {}", args[i]);
+                return 2;
+            }
+            filter.level = *lv;
+        } else if (arg == "--logger" && has_value) {
+            filter.logger = args[++i];
+        } else if ((arg == "--since" || arg == "--until") && has_value) {
+            const auto time = parse_time(args[++i]);
+            if (!time) {
+                std::println(stderr, "invalid time: {}", args[i]);
+                return 2;
+            }
+            (arg == "--since" ? filter.since : filter.until) = *time;
+        } else if (arg == "--precision" && has_value) {
+            const auto p = parse_precision(args[++i]);
+            if (!p) {
+                std::println(stderr, "invalid precision: {}", args[i]);
+                return 2;
+            }
+            precision = *p;
+        } else if (arg == "-o" && has_value) {
+            output = args[++i];
+        } else if (input.empty() && !arg.starts_with('-')) {
+            input = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (input.empty()) {
+        usage();
+        return 2;
+    }
+
+    std::ifstream in(input, std::ios::binary);
+    if (!in) {
+        std::println(stderr, "cannot open {}", input);
+        return 1;
+    }
+    const std::vector<char> data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+    std::FILE *out = output.empty() ? stdout : std::fopen(output.c_str(), "wb");
+    if (out == nullptr) {
+        std::println(stderr, "cannot open {}", output);
+        return 1;
+    }
+    TimestampCache timestamp(precision);
+    std::string buffer;
+    const bool ok = binlog::decode(std::as_bytes(std::span(data)), filter, [&](const Record &record) {
+        FilePattern{}.render(buffer, record, timestamp, false);
+        buffer.push_back('\n');
+        if (buffer.size() >= 1 << 16) {
+            std::fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    });
+    std::fwrite(buffer.data(), 1, buffer.size(), out);
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    if (!ok) {
+        std::println(stderr, "{} is not a binary log file", input);
+        return 1;
+    }
+    return 0;
+}
@@ -1,21 +1,54 @@
 #include <huxint/logger.hpp>
+#include <huxint/logger/macros.hpp>
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <new>
 #include <print>
+#include <sstream>
+#include <stdexcept>
 #include <thread>
 #include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 统计全局堆分配次数
+static std::atomic<std::size_t> allocations{0};
+
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
 
 namespace huxint {
 
 class MemorySink final : public Sink {
 public:
-    void write(Level level,
-               std::string_view name,
-               const std::string &msg,
-               std::string_view file,
-               std::uint32_t line) override {
+    void write(const Record &record) override {
         std::scoped_lock lock(mutex_);
-        logs_.push_back({level, std::string(name), msg, std::string(file), line});
+        logs_.push_back(
+            {record.level, std::string(record.name), std::string(record.msg), std::string(record.file), record.line});
     }
 
     void flush() override {}
@@ -54,8 +87,102 @@ private:
     std::mutex mutex_;
 };
 
+// 只计数, 不分配内存
+class NullSink final : public Sink {
+public:
+    void write(const Record &) override {
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void flush() override {}
+
+    auto size() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::size_t> count_{0};
+};
+
+// 打开前阻塞后台线程, 模拟卡住的磁盘或管道
+class GateSink final : public Sink {
+public:
+    void write(const Record &) override {
+        entered_.store(true, std::memory_order_release);
+        while (!open_.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void flush() override {}
+
+    void open() {
+        open_.store(true, std::memory_order_release);
+    }
+
+    // 后台线程是否已被挡住
+    bool entered() const {
+        return entered_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<bool> open_{false};
+    std::atomic<bool> entered_{false};
+};
+
+// 统计写入和 sync 次数
+class SyncSink final : public Sink {
+public:
+    void write(const Record &) override {
+        writes_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void flush() override {}
+
+    void sync() override {
+        syncs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto writes() const {
+        return writes_.load(std::memory_order_relaxed);
+    }
+
+    auto syncs() const {
+        return syncs_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::size_t> writes_{0};
+    std::atomic<std::size_t> syncs_{0};
+};
+
+// 每批写入前等待固定时间, 模拟慢 sink
+class SlowSink final : public Sink {
+public:
+    void write(const Record &) override {}
+
+    void write_batch(std::span<const Record>) override {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    void flush() override {}
+};
+
 } // namespace huxint
 
+// 没有参数编码的类型, 只能在调用线程格式化
+struct Point {
+    int x;
+    int y;
+};
+
+template <>
+struct std::formatter<Point> : std::formatter<int> {
+    auto format(const Point &p, std::format_context &ctx) const {
+        return std::format_to(ctx.out(), "({}, {})", p.x, p.y);
+    }
+};
+
 // 测试框架
 struct Test {
     const char *name;
@@ -211,18 +338,31 @@ bool test_multiple_sinks() {
     return sink1->size() == 1 && sink2->size() == 1;
 }
 
-// 9. 线程池配置测试
+// 9. 线程池配置测试: 其他线程写日志的同时调整工作线程数, 不丢也不重复
 bool test_thread_pool() {
     using L = huxint::Logger<"Pool">;
     auto *sink = L::add_sink<huxint::MemorySink>();
+    L::add_sink<huxint::MemorySink>();
     L::set_thread_count(4);
 
     for (int i = 0; i < 200; ++i) {
         L::info_raw("log {}", i);
     }
     L::flush();
+    const bool ok = sink->size() == 200;
 
-    return sink->size() == 200;
+    std::jthread writer([] {
+        for (int i = 0; i < 20000; ++i) {
+            L::info_raw("busy {}", i);
+        }
+    });
+    for (const std::size_t count : {2, 1, 8, 3}) {
+        L::set_thread_count(count);
+    }
+    writer.join();
+    L::flush();
+    L::set_thread_count(1);
+    return ok && sink->size() == 20200;
 }
 
 // 10. 格式化参数测试
@@ -236,24 +376,60 @@ bool test_format_args() {
     return sink->logs()[0].msg == "int: 42, str: hello, float: 3.14";
 }
 
-// 11. 压力测试
+// 11. 延迟格式化测试: 参数在调用线程编码, 后台线程格式化
+bool test_deferred_args() {
+    using L = huxint::Logger<"Deferred">;
+    auto *sink = L::add_sink<huxint::MemorySink>();
+
+    {
+        std::string temp = "temporary string outlives nothing";
+        L::info_raw("{} {} {} {} {:>4}", temp, std::string_view("view"), 'c', true, 7u);
+    }
+    L::info_raw("{} {:.3f} {:x}", 1.5f, 2.0, std::uint64_t{255});
+    L::info_raw("{}", 1.25L); // long double 不可编码, 回退到调用线程格式化
+    L::flush();
+
+    return sink->size() == 3 && sink->logs()[0].msg == "temporary string outlives nothing view c true    7" &&
+           sink->logs()[1].msg == "1.5 2.000 ff" && sink->logs()[2].msg == "1.25";
+}
+
+// 12. 压力测试
 bool test_stress() {
     using L = huxint::Logger<"Stress">;
     auto *sink = L::add_sink<huxint::MemorySink>();
     L::set_thread_count(8);
 
+    constexpr int threads = 20;
+    constexpr int per_thread = 5000;
+    std::vector<std::int64_t> latency(threads * per_thread); // 生产者单次调用耗时 (ns)
+
     auto start = std::chrono::steady_clock::now();
-    run_threads<L>(20, 5000, [](int t, int i) {
+    run_threads<L>(threads, per_thread, [&latency](int t, int i) {
+        auto begin = std::chrono::steady_clock::now();
         L::info_raw("T{} I{}", t, i);
+        auto end = std::chrono::steady_clock::now();
+        latency[t * per_thread + i] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
     });
     L::flush();
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
 
-    std::print("{} logs in {}ms ({} logs/s) ", sink->size(), ms, sink->size() * 1000 / (ms + 1));
+    auto percentile = [&latency](double p) {
+        auto it = latency.begin() + static_cast<std::ptrdiff_t>(p * static_cast<double>(latency.size() - 1));
+        std::ranges::nth_element(latency, it);
+        return *it;
+    };
+    auto p50 = percentile(0.50);
+    auto p99 = percentile(0.99);
+    std::print("{} logs in {}ms ({} logs/s, p50 {}ns, p99 {}ns) ",
+               sink->size(),
+               ms,
+               sink->size() * 1000 / (ms + 1),
+               p50,
+               p99);
     return sink->size() == 100000;
 }
 
-// 12. 数据完整性测试
+// 13. 数据完整性测试
 bool test_integrity() {
     using L = huxint::Logger<"Integrity">;
     auto *sink = L::add_sink<huxint::MemorySink>();
@@ -280,6 +456,928 @@ bool test_integrity() {
     return true;
 }
 
+// 14. 批量写入测试: FileSink 整批格式化后一次写出
+bool test_file_batch() {
+    using L = huxint::Logger<"FileBatch">;
+    const auto path = std::filesystem::temp_directory_path() / "huxint_file_batch.log";
+    std::filesystem::remove(path);
+    L::add_sink<huxint::FileSink>(path.string());
+
+    constexpr int n = 5000;
+    run_threads<L>(5, n / 5, [](int t, int i) {
+        L::info_raw("T{} I{}", t, i);
+    });
+    L::flush();
+
+    std::ifstream in(path);
+    std::string line;
+    int lines = 0;
+    bool ok = true;
+    while (std::getline(in, line)) {
+        ++lines;
+        ok = ok && line.starts_with("[time: ") && line.contains("]<FileBatch> T");
+    }
+    return ok && lines == n;
+}
+
+// 15. PosixFileSink 测试: 小缓冲区多次写出, 重新打开后继续追加
+bool test_posix_file_sink() {
+    const auto path = std::filesystem::temp_directory_path() / "huxint_posix_sink.log";
+    std::filesystem::remove(path);
+    std::size_t syscalls = 0;
+    {
+        huxint::PosixFileSink sink(path.string(), {.buffer_size = 8 * 1024, .sync = huxint::SyncPolicy::OnError});
+        std::vector<std::string> messages;
+        std::vector<huxint::Record> records;
+        for (int i = 0; i < 1000; ++i) {
+            messages.push_back(std::format("message {}", i));
+        }
+        for (int i = 0; i < 1000; ++i) {
+            records.push_back({huxint::Level::Info, "Posix", messages[i], "", 0, std::chrono::system_clock::now()});
+        }
+        sink.write_batch(records);
+        sink.write({huxint::Level::Error, "Posix", "error", "", 0, std::chrono::system_clock::now()});
+        syscalls = sink.syscalls();
+    }
+    {
+        huxint::PosixFileSink sink(path.string());
+        sink.write({huxint::Level::Info, "Posix", "reopened", "", 0, std::chrono::system_clock::now()});
+    }
+
+    std::ifstream in(path);
+    std::string line, last;
+    int lines = 0;
+    while (std::getline(in, line)) {
+        ++lines;
+        last = line;
+    }
+    return lines == 1002 && last.ends_with("]<Posix> reopened") && syscalls < 100;
+}
+
+// 16. 时间戳缓存测试: 跨分钟/跨日与 chrono 格式化结果一致, 支持小数秒精度
+bool test_timestamp_cache() {
+    using namespace std::chrono;
+    huxint::TimestampCache seconds_cache;
+    sys_time<milliseconds> start = sys_days{2024y / February / 29} + 23h + 58min;
+    for (auto t = start; t < start + 200s; t += 700ms) {
+        auto expected = std::format("{:%F %T}", floor<seconds>(t));
+        if (seconds_cache.format(time_point_cast<system_clock::duration>(t)) != expected) {
+            return false;
+        }
+    }
+
+    auto t = sys_days{1999y / December / 31} + 23h + 59min + 59s + 123456789ns;
+    auto tp = time_point_cast<system_clock::duration>(t);
+    return huxint::TimestampCache(huxint::Precision::Millis).format(tp) == "1999-12-31 23:59:59.123" &&
+           huxint::TimestampCache(huxint::Precision::Micros).format(tp) == "1999-12-31 23:59:59.123456" &&
+           huxint::TimestampCache(huxint::Precision::Nanos).format(tp).starts_with("1999-12-31 23:59:59.123456");
+}
+
+// 17. 分配次数测试: 每次调用只生成一条记录, 分配次数不随 sink 数量增长
+template <typename L>
+std::size_t allocations_per_1000() {
+    for (int i = 0; i < 1000; ++i) { // 预热: 注册线程队列, 扩充后台缓冲
+        L::info_raw("T{} I{}", 1, i);
+    }
+    L::flush();
+    auto before = allocations.load();
+    for (int i = 0; i < 1000; ++i) {
+        L::info_raw("T{} I{}", 1, i);
+    }
+    L::flush();
+    return allocations.load() - before;
+}
+
+bool test_allocations_per_sink() {
+    using L1 = huxint::Logger<"Alloc1">;
+    using L3 = huxint::Logger<"Alloc3">;
+    auto *sink = L1::add_sink<huxint::NullSink>();
+    for (int i = 0; i < 3; ++i) {
+        L3::add_sink<huxint::NullSink>();
+    }
+
+    auto one = allocations_per_1000<L1>();
+    auto three = allocations_per_1000<L3>();
+    std::print("{} vs {} allocations per 1000 logs ", one, three);
+    return sink->size() == 2000 && one == three;
+}
+
+// 18. 布局测试: 编译期 Pattern 与运行期 Layout 输出一致, 可选段按字段是否为空省略
+bool test_pattern() {
+    using namespace std::chrono;
+    const huxint::Record named{huxint::Level::Warn, "App", "hello", "main.cpp", 42, sys_days{2024y / May / 1} + 8h};
+    const huxint::Record bare{huxint::Level::Info, "", "plain", "", 0, sys_days{2024y / May / 1} + 8h};
+    huxint::TimestampCache timestamp;
+
+    auto render = [&](const auto &layout, const huxint::Record &record) {
+        std::string out;
+        layout.render(out, record, timestamp, false);
+        return out;
+    };
+    constexpr auto text = "{time} {{{level}}}{?<{name}>?} {?{file}:{line} ?}{msg}";
+    const huxint::Pattern<"{time} {{{level}}}{?<{name}>?} {?{file}:{line} ?}{msg}"> pattern;
+    const huxint::Layout layout(text);
+    if (render(pattern, named) != "2024-05-01 08:00:00 { WARN}<App> main.cpp:42 hello" ||
+        render(pattern, bare) != "2024-05-01 08:00:00 { INFO} plain" || render(layout, named) != render(pattern, named) ||
+        render(layout, bare) != render(pattern, bare) || pattern.bound(named) < render(pattern, named).size()) {
+        return false;
+    }
+
+    for (auto bad : {"{unknown}", "{msg", "msg}", "{?{name}", "{?{?{name}?}?}"}) {
+        try {
+            huxint::Layout{bad};
+            return false;
+        } catch (const std::invalid_argument &) {
+        }
+    }
+    return render(huxint::FilePattern{}, named) == "[time: 2024-05-01 08:00:00][ WARN]<App> main.cpp:42 hello";
+}
+
+// 19. 编译期级别测试: 低于 MinLevel 的调用被剔除, 宏前端在级别关闭时不对参数求值
+bool test_compile_time_level() {
+    using L = huxint::Logger<"MinLevel", huxint::Level::Info>;
+    static_assert(L::min_level() == huxint::Level::Info);
+    auto *sink = L::add_sink<huxint::MemorySink>();
+
+    int evaluated = 0;
+    auto arg = [&] {
+        return ++evaluated;
+    };
+    L::trace("stripped {}", 1);
+    L::debug_raw("stripped {}", 2);
+    HUXINT_TRACE(L, "stripped {}", arg());
+    HUXINT_DEBUG(L, "stripped {}", arg());
+    HUXINT_INFO(L, "kept {}", arg());
+    const bool compile_time = evaluated == 1;
+
+    L::level(huxint::Level::Error); // 运行期级别同样拦截宏参数求值
+    HUXINT_WARN(L, "filtered {}", arg());
+    HUXINT_ERROR(L, "kept {}", arg());
+    L::flush();
+    L::level(huxint::Level::Trace);
+
+    return compile_time && evaluated == 2 && sink->size() == 2 && !L::enabled(huxint::Level::Debug) &&
+           L::enabled(huxint::Level::Info);
+}
+
+// 20. 背压测试: 队列满时按策略丢弃并计数, Error 不丢, 压力解除后补写汇总
+template <typename L>
+bool check_overflow(huxint::Overflow policy) {
+    auto *sink = L::template add_sink<huxint::MemorySink>();
+    auto *gate = L::template add_sink<huxint::GateSink>();
+    L::set_queue_capacity(16);
+    L::set_overflow(policy);
+
+    // 队列容量只对之后首次写日志的线程生效, 在新线程中写
+    constexpr int n = 1000;
+    std::jthread([&] {
+        for (int i = 0; i < n; ++i) {
+            L::info_raw("I{}", i);
+        }
+        gate->open();
+        for (int i = 0; i < 5; ++i) {
+            L::error_raw("E{}", i);
+        }
+    }).join();
+    L::flush();
+    L::set_queue_capacity(1024); // 所有 logger 共用, 恢复默认
+
+    const auto dropped = L::dropped();
+    const auto &logs = sink->logs();
+    const auto infos = sink->count(huxint::Level::Info);
+    const auto summary = std::ranges::find(logs, std::format("dropped {} records", dropped), &huxint::MemorySink::Entry::msg);
+    const bool newest_kept = std::ranges::find(logs, std::format("I{}", n - 1), &huxint::MemorySink::Entry::msg) != logs.end();
+    return dropped > 0 && infos + dropped == n && sink->count(huxint::Level::Error) == 5 && summary != logs.end() &&
+           newest_kept == (policy == huxint::Overflow::DropOldest);
+}
+
+bool test_overflow() {
+    return check_overflow<huxint::Logger<"DropNewest">>(huxint::Overflow::DropNewest) &&
+           check_overflow<huxint::Logger<"DropOldest">>(huxint::Overflow::DropOldest);
+}
+
+// 21. 多工作线程顺序测试: 8 个工作线程下每个 sink 收到的同一生产者序号单调递增
+bool test_worker_ordering() {
+    using L = huxint::Logger<"Ordering">;
+    std::vector<huxint::MemorySink *> sinks;
+    for (int i = 0; i < 3; ++i) {
+        sinks.push_back(L::add_sink<huxint::MemorySink>());
+    }
+    L::set_thread_count(8);
+
+    constexpr int threads = 8;
+    constexpr int per_thread = 5000;
+    run_threads<L>(threads, per_thread, [](int t, int i) {
+        L::info_raw("{} {}", t, i);
+    });
+    L::flush();
+    L::set_thread_count(1);
+
+    for (auto *sink : sinks) {
+        std::vector<int> next(threads, 0);
+        for (const auto &entry : sink->logs()) {
+            int t = 0;
+            int i = 0;
+            std::sscanf(entry.msg.c_str(), "%d %d", &t, &i);
+            if (i != next[t]++) {
+                return false;
+            }
+        }
+        if (std::ranges::count(next, per_thread) != threads) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 22. 轮转文件测试: 按大小轮转并在后台压缩, 只保留最近几个文件; 跨小时边界轮转
+std::string read_segment(const std::filesystem::path &path) {
+#ifdef HUXINT_LOG_ZLIB
+    std::string data;
+    if (gzFile in = gzopen(path.c_str(), "rb")) {
+        char buffer[4096];
+        for (int n; (n = gzread(in, buffer, sizeof(buffer))) > 0;) {
+            data.append(buffer, static_cast<std::size_t>(n));
+        }
+        gzclose(in);
+    }
+    return data;
+#else
+    const auto raw = path.string() + ".raw";
+    huxint::lz::decompress_file(path.string(), raw);
+    std::ifstream in(raw, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+#endif
+}
+
+bool test_rotating_file_sink() {
+    using namespace std::chrono;
+    const auto dir = std::filesystem::temp_directory_path() / "huxint_rotate";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "app.log";
+
+    constexpr int n = 1000;
+    std::size_t index = 0;
+    {
+        huxint::RotatingFileSink sink(path.string(), {.max_size = 4096, .max_files = 3, .compress = true});
+        for (int i = 0; i < n; ++i) {
+            const auto msg = std::format("line {}", i);
+            sink.write({huxint::Level::Info, "Rotate", msg, "", 0, system_clock::now()});
+        }
+        sink.flush();
+        sink.wait_background();
+        index = sink.index();
+    }
+    if (index < 4 || std::distance(std::filesystem::directory_iterator(dir), {}) != 4) {
+        return false;
+    }
+
+    // 保留的三个压缩文件加当前文件, 内容首尾相接
+    std::string text;
+    for (auto k = index - 2; k <= index; ++k) {
+        text += read_segment(std::format("{}.{}{}", path.string(), k, huxint::lz::extension));
+    }
+    std::ifstream current(path);
+    text.append(std::istreambuf_iterator<char>(current), {});
+    std::istringstream lines(text);
+    int expected = -1;
+    for (std::string line; std::getline(lines, line);) {
+        const auto i = std::stoi(line.substr(line.rfind(' ') + 1));
+        if (expected != -1 && i != expected) {
+            return false;
+        }
+        expected = i + 1;
+    }
+    if (expected != n) {
+        return false;
+    }
+
+    const auto hourly = dir / "hourly.log";
+    huxint::RotatingFileSink sink(hourly.string(), {.max_size = 0, .rotation = huxint::Rotation::Hourly});
+    const system_clock::time_point boundary = floor<hours>(system_clock::now()) + 1h;
+    for (system_clock::time_point t : {boundary - 1s, boundary, boundary + 30min, boundary + 1h}) {
+        sink.write({huxint::Level::Info, "Rotate", "tick", "", 0, t});
+    }
+    return sink.index() == 2;
+}
+
+// 23. 内置压缩格式往返测试
+bool test_lz_roundtrip() {
+    std::string input;
+    for (int i = 0; i < 20000; ++i) {
+        input += std::format("[time: 2024-05-01 08:00:{:02}][ INFO]<app> request {} took {} us\n", i % 60, i, i * 7 % 1000);
+    }
+    input += std::string(3, '\0') + "tail";
+    std::string packed;
+    std::string output;
+    huxint::lz::compress_block(input, packed);
+    return huxint::lz::decompress_block(packed, input.size(), output) && output == input && packed.size() * 4 < input.size();
+}
+
+// 24. 二进制文件测试: 解码结果与 FileSink 文本逐行一致, 重新打开后字典和记录接续, 支持过滤
+bool test_binary_file_sink() {
+    using L = huxint::Logger<"Binary">;
+    const auto dir = std::filesystem::temp_directory_path();
+    const auto text_path = dir / "huxint_binary.log";
+    const auto binary_path = dir / "huxint_binary.bin";
+    std::filesystem::remove(text_path);
+    std::filesystem::remove(binary_path);
+
+    auto *binary = L::add_sink<huxint::BinaryFileSink>(binary_path.string(), huxint::BinaryFileOptions{.reserve = 4096});
+    L::add_sink<huxint::FileSink>(text_path.string());
+    const auto when = std::chrono::sys_days{std::chrono::year{2024} / 5 / 1} + std::chrono::milliseconds(1234);
+    for (int i = 0; i < 200; ++i) {
+        L::info("request {} took {:.2f} ms from {}", i, i * 0.25, std::string("host-") + std::to_string(i % 7));
+        L::warn_raw("{1}:{0:>4} {2} {3:x} {4:%F %T}", i, 'c', true, std::uint64_t(i) * 977, when);
+        L::error_raw("{}", 1.25L); // 不可编码, 在调用线程格式化
+    }
+    L::flush();
+
+    auto read_binary = [&] {
+        std::ifstream in(binary_path, std::ios::binary);
+        return std::vector<char>{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    };
+    auto decode = [&](const huxint::binlog::Filter &filter) {
+        const auto data = read_binary();
+        std::vector<std::string> lines;
+        huxint::TimestampCache timestamp;
+        huxint::binlog::decode(std::as_bytes(std::span(data)), filter, [&](const huxint::Record &record) {
+            std::string line;
+            huxint::FilePattern{}.render(line, record, timestamp, false);
+            lines.push_back(std::move(line));
+        });
+        return lines;
+    };
+
+    std::vector<std::string> expected;
+    std::ifstream text(text_path);
+    for (std::string line; std::getline(text, line);) {
+        expected.push_back(line);
+    }
+    const auto size = binary->size();
+    if (decode({}) != expected || expected.size() != 600 || size >= std::filesystem::file_size(text_path)) {
+        return false;
+    }
+
+    // 单独的文件关闭后再打开续写: 恢复字典, 不重复写字典项
+    const auto reopen_path = dir / "huxint_binary_reopen.bin";
+    std::filesystem::remove(reopen_path);
+    for (int round = 0; round < 2; ++round) {
+        huxint::BinaryFileSink sink(reopen_path.string());
+        const auto msg = std::format("round {}", round);
+        sink.write({huxint::Level::Info, "Reopen", msg, "main.cpp", 7, std::chrono::system_clock::now()});
+    }
+    std::ifstream in(reopen_path, std::ios::binary);
+    const std::vector<char> data{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    std::vector<std::string> msgs;
+    int strings = 0;
+    huxint::binlog::parse(
+        std::as_bytes(std::span(data)),
+        [&](std::uint32_t, std::string_view) {
+            ++strings;
+        },
+        [](const huxint::binlog::Entry &) {});
+    huxint::binlog::decode(std::as_bytes(std::span(data)), {}, [&](const huxint::Record &record) {
+        msgs.emplace_back(record.msg);
+    });
+    if (strings != 3 || msgs != std::vector<std::string>{"round 0", "round 1"}) {
+        return false;
+    }
+
+    const auto errors = decode({.level = huxint::Level::Error, .logger = std::nullopt});
+    const auto none = decode({.logger = "Other"});
+    return errors.size() == 200 && none.empty();
+}
+
+// 25. Fatal 直写: 开启后 fatal 返回时记录已写出并 sync
+bool test_fatal_write_through() {
+    using L = huxint::Logger<"WriteThrough">;
+    auto *sink = L::add_sink<huxint::SyncSink>();
+    L::set_fatal_write_through(true);
+    L::fatal("boom {}", 1);
+    const bool synced = sink->writes() == 1 && sink->syncs() == 1;
+    L::set_fatal_write_through(false);
+    L::fatal("again");
+    L::flush();
+    return synced && sink->writes() == 2 && sink->syncs() == 1;
+}
+
+// 26. 崩溃处理: 后台线程被挡住时子进程崩溃, 队列中的日志仍由崩溃处理写进文件
+bool test_crash_handler() {
+    using L = huxint::Logger<"Crash">;
+    auto *gate = L::add_sink<huxint::GateSink>();
+    L::info("blocked");
+    // 后台线程停在 sink 中, 不持有队列的锁, 此时 fork 是安全的
+    while (!gate->entered()) {
+        std::this_thread::yield();
+    }
+    const auto path = std::filesystem::temp_directory_path() / "huxint_crash.log";
+    const auto warn_path = std::filesystem::temp_directory_path() / "huxint_crash_warn.log";
+    auto read_lines = [](const std::filesystem::path &file) {
+        std::vector<std::string> lines;
+        std::ifstream in(file);
+        for (std::string line; std::getline(in, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    };
+    auto crash_child = [&](int expected_signal, void (*crash)()) {
+        std::filesystem::remove(path);
+        std::filesystem::remove(warn_path);
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            const rlimit no_core{0, 0};
+            ::setrlimit(RLIMIT_CORE, &no_core);
+            ::dup2(::open("/dev/null", O_WRONLY), 2); // 崩溃提示和默认 terminate 的输出不混进测试结果
+            huxint::install_crash_handler();
+            L::add_sink<huxint::PosixFileSink>(path.string());
+            // 只要 Warn 的 sink 在崩溃抢救时也收不到 Info
+            L::add_sink(std::make_shared<huxint::PosixFileSink>(warn_path.string()), huxint::Level::Warn);
+            for (int i = 0; i < 100; ++i) {
+                L::info("queued {}", i);
+            }
+            L::warn("warning");
+            crash();
+            std::_Exit(0);
+        }
+        int status = 0;
+        ::waitpid(pid, &status, 0);
+        const auto lines = read_lines(path);
+        const auto warnings = read_lines(warn_path);
+        if (!WIFSIGNALED(status) || WTERMSIG(status) != expected_signal || lines.size() != 101 ||
+            !lines[100].ends_with(" warning") || warnings.size() != 1 || !warnings[0].ends_with(" warning")) {
+            return false;
+        }
+        for (int i = 0; i < 100; ++i) {
+            if (!lines[i].contains("[ INFO]<Crash>") || !lines[i].ends_with(std::format(" queued {}", i))) {
+                return false;
+            }
+        }
+        return true;
+    };
+    const bool ok = crash_child(SIGSEGV,
+                                [] {
+                                    std::raise(SIGSEGV);
+                                }) &&
+                    crash_child(SIGABRT,
+                                [] {
+                                    std::abort();
+                                }) &&
+                    crash_child(SIGABRT, [] {
+                        std::terminate();
+                    });
+    gate->open();
+    L::flush();
+    return ok;
+}
+
+// 27. 注册表: 按名字查到编译期 logger 的同一状态, sink 可挂到多个 logger, 运行期统一调整级别
+bool test_registry() {
+    using A = huxint::Logger<"RegistryA">;
+    using B = huxint::Logger<"RegistryB">;
+    auto &registry = huxint::registry();
+    if (registry.find("RegistryA") != &A::state() || registry.find("RegistryMissing") != nullptr ||
+        &registry.get("RegistryB") != &B::state()) {
+        return false;
+    }
+
+    auto shared = std::make_shared<huxint::MemorySink>();
+    A::add_sink(shared);
+    B::add_sink(shared);
+    auto &runtime = registry.get("RegistryRuntime");
+    runtime.add_sink(shared);
+    A::info("from a");
+    B::info("from b");
+    registry.flush();
+    const bool both = shared->size() == 2 && shared->logs()[0].name == "RegistryA" && shared->logs()[1].name == "RegistryB";
+
+    // 重新加载配置: 按名字前缀统一调高级别
+    registry.for_each([](huxint::LoggerState &state) {
+        if (state.name().starts_with("Registry")) {
+            state.level(huxint::Level::Error);
+        }
+    });
+    A::info("filtered");
+    B::error("kept");
+    registry.flush();
+    const bool reloaded = A::level() == huxint::Level::Error && runtime.level() == huxint::Level::Error &&
+                          shared->size() == 3 && shared->logs()[2].msg == "kept";
+    A::level(huxint::Level::Trace);
+    B::level(huxint::Level::Trace);
+    return both && reloaded;
+}
+
+// 28. 指标: 各级别提交/写出条数 (含已退出线程), 慢 sink 的耗时和延迟直方图, 周期性摘要
+bool test_metrics() {
+    using L = huxint::Logger<"Metrics">;
+    auto *fast = L::add_sink<huxint::NullSink>();
+    L::add_sink<huxint::SlowSink>();
+    L::set_metrics(true);
+    run_threads<L>(4, 50, [](int t, int i) {
+        L::debug_raw("T{} I{}", t, i);
+    });
+    L::warn("slow {}", 1);
+    L::flush();
+    const auto metrics = L::metrics();
+    using huxint::Level;
+    auto at = [](const auto &counts, Level lv) {
+        return counts[static_cast<std::size_t>(lv)];
+    };
+    const bool counted = at(metrics.submitted, Level::Debug) == 200 && at(metrics.submitted, Level::Warn) == 1 &&
+                         at(metrics.written, Level::Debug) == 200 && at(metrics.written, Level::Warn) == 1 &&
+                         huxint::LoggerMetrics::total(metrics.dropped) == 0 && fast->size() == 201;
+    const auto &slow = metrics.sinks[1];
+    const bool timed = metrics.sinks.size() == 2 && metrics.sinks[0].records == 201 && slow.records == 201 &&
+                       slow.write_time >= std::chrono::milliseconds(2) * slow.batches && slow.flushes >= 1 &&
+                       metrics.latency.count() == 201 && metrics.latency.percentile(1.0) >= std::chrono::milliseconds(1);
+
+    // 摘要写到单独的 sink, 不挂在本 logger 上
+    auto report = std::make_shared<huxint::MemorySink>();
+    L::report_metrics(report, std::chrono::milliseconds(5));
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (report->size() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    L::report_metrics(nullptr, {});
+    L::set_metrics(false);
+    L::flush(); // 等后台线程写完可能正在写的一条
+    const auto &line = report->logs()[0];
+    const bool reported = report->size() >= 2 && line.name == "Metrics" && line.msg.starts_with("metrics submitted=201 ") &&
+                          line.msg.contains(" sink1={records=201 ");
+    return counted && timed && reported;
+}
+
+// 29. 稳定状态零分配: 预热后, 延迟格式化, 调用线程格式化和长字符串参数的消息 (不超过 inline_size)
+// 在生产者和后台线程上都不再分配堆内存; 开启 sink 工作线程时, 批次、任务和挑选缓冲同样复用
+template <typename L>
+std::size_t steady_allocations(int warmup) {
+    const std::string long_arg(100, 'x');
+    auto log_round = [&](int n) {
+        for (int i = 0; i < n; ++i) {
+            L::info("deferred {} {:.2f} {}", i, 0.5 * i, "str");
+            L::info_raw("formatted {} at {}", i, Point{i, -i});
+            L::warn("long {} {}", long_arg, i);
+        }
+        L::flush();
+    };
+    for (int i = 0; i < warmup; ++i) {
+        log_round(1000); // 预热: 注册线程队列和计数, 扩充各处复用的缓冲
+    }
+    const auto before = allocations.load();
+    log_round(1000);
+    return allocations.load() - before;
+}
+
+bool test_zero_allocation() {
+    using L = huxint::Logger<"ZeroAlloc">;
+    auto *sink = L::add_sink<huxint::NullSink>(); // 需要文本, 后台线程会格式化每一条
+    const auto direct = steady_allocations<L>(1);
+
+    using W = huxint::Logger<"ZeroAllocWorkers">;
+    auto *all = W::add_sink<huxint::NullSink>();
+    auto warn = std::make_shared<huxint::NullSink>(); // 只要一部分记录, 走挑选的路径
+    W::add_sink(warn, huxint::Level::Warn);
+    W::set_thread_count(2);
+    const auto workers = steady_allocations<W>(3);
+    W::set_thread_count(1);
+    std::print("{} / {} allocations per 3000 logs ", direct, workers);
+    return direct == 0 && workers == 0 && sink->size() == 6000 && all->size() == 12000 && warn->size() == 4000;
+}
+
+// 30. 结构化字段: kv() 按原始类型到达 sink, JsonSink 转义后逐行输出 JSON 对象, 文本布局追加 key=value
+bool test_structured_fields() {
+    using L = huxint::Logger<"Structured">;
+    using huxint::kv;
+    const auto dir = std::filesystem::temp_directory_path();
+    const auto json_path = dir / "huxint_structured.jsonl";
+    const auto text_path = dir / "huxint_structured.log";
+    std::filesystem::remove(json_path);
+    std::filesystem::remove(text_path);
+    L::add_sink<huxint::JsonSink>(json_path.string());
+    L::add_sink<huxint::FileSink>(text_path.string());
+
+    const std::string user = "ali\"ce\\\n\x01";
+    const std::string long_value(300, 'v'); // 超过 inline_size 也不回退到调用线程格式化
+    L::info_raw("request {} done", kv("id", 7), kv("latency_us", 1.5), kv("user", user), kv("ok", true));
+    L::warn("plain {}", 1);
+    L::error_raw("big", kv("value", long_value));
+    L::info_raw("clash", kv("msg", 1), kv("level", "x"), kv("lines", 2)); // 与内置键同名的字段加前缀
+    L::flush();
+
+    std::vector<std::string> json;
+    std::ifstream in(json_path);
+    for (std::string line; std::getline(in, line);) {
+        json.push_back(line);
+    }
+    std::vector<std::string> text;
+    std::ifstream text_in(text_path);
+    for (std::string line; std::getline(text_in, line);) {
+        text.push_back(line);
+    }
+    return json.size() == 4 && text.size() == 5 && json[0].starts_with(R"({"time":")") &&
+           json[0].contains(R"(Z","level":"INFO","logger":"Structured","thread":)") &&
+           json[0].ends_with(R"("msg":"request 7 done","id":7,"latency_us":1.5,"user":"ali\"ce\\\n\u0001","ok":true})") &&
+           json[1].contains(R"("line":)") && json[1].ends_with(R"("msg":"plain 1"})") &&
+           json[2].ends_with(std::format(R"("msg":"big","value":"{}"}})", long_value)) &&
+           json[3].ends_with(R"("msg":"clash","fields.msg":1,"fields.level":"x","lines":2})") &&
+           text[0].ends_with("request 7 done id=7 latency_us=1.5 user=ali\"ce\\") && text[2].ends_with(" plain 1") &&
+           text[3].ends_with("big value=" + long_value);
+}
+
+// 31. 生产者隔离: 慢 sink 卡住共用的后台线程时, 丢弃策略下其他 logger 的多个生产者仍能写完, 提交 = 写出 + 丢弃
+bool test_producer_isolation() {
+    using Noisy = huxint::Logger<"IsolationNoisy">;
+    using Critical = huxint::Logger<"IsolationCritical">;
+    auto *gate = Noisy::add_sink<huxint::GateSink>();
+    auto *sink = Critical::add_sink<huxint::MemorySink>();
+    Critical::set_overflow(huxint::Overflow::DropOldest);
+    Critical::set_queue_capacity(64);
+
+    Noisy::info_raw("stall");
+    while (!gate->entered()) {
+        std::this_thread::yield();
+    }
+    constexpr int threads = 4;
+    constexpr int n = 20000;
+    run_threads<Critical>(threads, n, [](int t, int i) {
+        Critical::info_raw("T{} I{}", t, i);
+    });
+    gate->open();
+    Critical::flush();
+    Critical::set_queue_capacity(1024);
+
+    const auto dropped = Critical::dropped();
+    return dropped > 0 && sink->count(huxint::Level::Info) + dropped == threads * n;
+}
+// 32. 按调用处限流: 每 N 次写一次, 每秒上限 (为 0 时全部拦下), 连续重复合并为一条并补写次数
+// 32. 按调用处限流: 每 N 次写一次, 每秒上限, 连续重复合并为一条并补写次数
+bool test_call_site_limits() {
+    using L = huxint::Logger<"Limited">;
+    auto *sink = L::add_sink<huxint::MemorySink>();
+    for (int i = 0; i < 100; ++i) {
+        HUXINT_WARN_EVERY_N(L, 10, "every {}", i);
+    }
+    for (int i = 0; i < 100; ++i) {
+        HUXINT_ERROR_PER_SECOND(L, 5, "burst {}", i);
+        HUXINT_ERROR_PER_SECOND(L, 0, "never {}", i); // 上限为 0 时一条也不写
+    }
+    // PerSecond(0) 直接判断: 每次都拦下, 也从不放行补写汇总
+    huxint::PerSecond zero(0);
+    bool silent = true;
+    for (int i = 0; i < 100; ++i) {
+        const auto verdict = zero.check(i);
+        silent = silent && !verdict.emit && verdict.suppressed == 0;
+    }
+    for (const auto *reason : {"refused", "refused", "refused", "timeout", "timeout"}) {
+        HUXINT_INFO_DEDUP(L, "connect failed: {}", reason);
+    }
+    L::flush();
+
+    std::vector<std::string> warns;
+    std::vector<std::string> infos;
+    std::size_t bursts = 0;
+    std::size_t nevers = 0;
+    for (const auto &entry : sink->logs()) {
+        if (entry.level == huxint::Level::Warn) {
+            warns.push_back(entry.msg);
+        } else if (entry.level == huxint::Level::Info) {
+            infos.push_back(entry.msg);
+        } else if (entry.msg.starts_with("burst ")) {
+            ++bursts;
+        } else if (entry.msg.starts_with("never ")) {
+            ++nevers;
+        }
+    }
+    // 循环可能跨过整秒边界, 此时第二秒再放行最多 5 条
+    return warns.size() == 10 && warns[1] == "every 10" && bursts >= 5 && bursts <= 10 && nevers == 0 && silent &&
+           infos == std::vector<std::string>{"connect failed: refused", "last message repeated 2 times",
+                                             "connect failed: timeout"};
+}
+
+// 33. backtrace: 低于级别的日志暂存在每个线程的环形缓冲中, Error 或 dump_backtrace() 时按时间顺序补写, 只补写一次;
+// 补写时仍按 sink 级别筛选
+bool test_backtrace() {
+    using L = huxint::Logger<"Backtrace">;
+    auto *sink = L::add_sink<huxint::MemorySink>();
+    auto errors = std::make_shared<huxint::MemorySink>();
+    L::add_sink(errors, huxint::Level::Error);
+    L::level(huxint::Level::Warn);
+    L::set_backtrace(4);
+    for (int i = 0; i < 10; ++i) {
+        L::debug("step {}", i);
+    }
+    std::jthread([] {
+        L::info("worker {}", std::string(300, 'w')); // 不可内联的消息同样暂存, 线程退出后仍能补写
+    }).join();
+    L::flush();
+    const bool quiet = sink->size() == 0;
+
+    L::error("failed");
+    L::error("failed again");
+    L::debug("after {}", 1);
+    HUXINT_DEBUG_EVERY_N(L, 100, "limited {}", 2); // 限流的调用同样暂存
+    L::dump_backtrace();
+    L::flush();
+    L::set_backtrace(0);
+
+    std::vector<std::string> msgs;
+    for (const auto &entry : sink->logs()) {
+        msgs.push_back(entry.msg);
+    }
+    const std::vector<std::string> expected{
+        "step 6", "step 7", "step 8", "step 9", "worker " + std::string(300, 'w'), "failed", "failed again", "after 1", "limited 2"};
+    return quiet && msgs == expected && sink->logs()[0].level == huxint::Level::Debug && errors->size() == 2 &&
+           errors->logs()[0].msg == "failed" && errors->logs()[1].msg == "failed again";
+}
+
+// 34. ConsoleSink 重定向到文件: 不输出颜色, 每批直接 write(2), 不等 flush 也会写出, 行完整
+bool test_console_redirect() {
+    using L = huxint::Logger<"ConsoleRedirect">;
+    const auto path = std::filesystem::temp_directory_path() / "huxint_console.log";
+    std::filesystem::remove(path);
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    L::add_sink<huxint::ConsoleSink<true>>(huxint::ColorConsolePattern{}, fd);
+    for (int i = 0; i < 10; ++i) {
+        L::info("line {}", i);
+    }
+    // 低流量时不停在缓冲里: 不调用 flush 也会写完
+    auto read_lines = [&] {
+        std::ifstream in(path);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(in, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    };
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (read_lines().size() < 10 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    const bool drained = read_lines().size() == 10;
+    L::flush();
+    L::clear_sinks();
+    ::close(fd);
+
+    const auto lines = read_lines();
+    return drained && lines.size() == 10 && lines[9].ends_with("line 9") &&
+           std::ranges::none_of(lines, [](const std::string &line) {
+               return line.contains('\033');
+           });
+}
+
+// 35. sink 级别与过滤谓词: 入队前按 sink 筛选, 没有 sink 要的日志不入队; 生效级别取各 sink 级别的最小值
+bool test_sink_levels() {
+    using L = huxint::Logger<"SinkLevels">;
+    using huxint::Level;
+    auto errors = std::make_shared<huxint::MemorySink>();
+    auto most = std::make_shared<huxint::MemorySink>();
+    L::add_sink(errors, Level::Error);
+    L::add_sink(most, Level::Debug, [](const huxint::SinkSite &site) {
+        return site.level != Level::Warn;
+    });
+    const bool lowered = L::state().threshold() == Level::Debug;
+    L::trace("trace {}", 1);
+    L::debug("debug {}", 2);
+    L::warn("warn {}", 3);
+    L::error("error {}", 4);
+    L::set_sink_level(most.get(), Level::Error);
+    const bool raised = L::state().threshold() == Level::Error && !L::enabled(Level::Info);
+    L::info("info {}", 5);
+    L::flush();
+
+    const auto m = L::metrics();
+    std::vector<std::string> got;
+    for (const auto &entry : most->logs()) {
+        got.push_back(entry.msg);
+    }
+    return lowered && raised && m.submitted[0] == 0 && m.submitted[2] == 0 && m.submitted[3] == 0 &&
+           errors->size() == 1 && errors->logs()[0].msg == "error 4" &&
+           got == std::vector<std::string>{"debug 2", "error 4"} && m.sinks[0].records == 1 && m.sinks[1].records == 2;
+}
+
+// 不等待结果的协程, 只用于测试 async_flush
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {}
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
+
+// 36. 不阻塞的 flush: 回调与 co_await 都在调用前的日志交给 sink 之后才继续. 协程经 resume 投递回测试线程恢复,
+// 恢复后照常写日志和 flush; 后台线程上调用阻塞的 flush 直接抛出
+bool test_async_flush() {
+    using L = huxint::Logger<"AsyncFlush">;
+    auto *sink = L::add_sink<huxint::MemorySink>();
+    constexpr int n = 1000;
+    for (int i = 0; i < n; ++i) {
+        L::info("record {}", i);
+    }
+    std::atomic<std::size_t> by_callback{0};
+    std::atomic<bool> refused{false};
+    L::flush([&] {
+        by_callback = sink->size();
+        try {
+            L::flush();
+        } catch (const std::logic_error &) {
+            refused = true;
+        }
+    });
+
+    // 最简单的执行器: 后台线程投递, 测试线程恢复
+    std::mutex mutex;
+    std::vector<std::coroutine_handle<>> posted;
+    auto post = [&](std::coroutine_handle<> handle) {
+        std::scoped_lock lock(mutex);
+        posted.push_back(handle);
+    };
+    std::atomic<std::size_t> by_await{0};
+    std::atomic<bool> resumed_here{false};
+    const auto self = std::this_thread::get_id();
+    auto flush_twice = [&]() -> Detached {
+        L::info("before await");
+        co_await L::async_flush(post);
+        const auto first = sink->size();
+        resumed_here = std::this_thread::get_id() == self;
+        L::info("after await");
+        L::flush();
+        by_await = first * 10000 + sink->size();
+    };
+    flush_twice();
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((by_callback == 0 || by_await == 0) && std::chrono::steady_clock::now() < deadline) {
+        std::vector<std::coroutine_handle<>> ready;
+        {
+            std::scoped_lock lock(mutex);
+            ready.swap(posted);
+        }
+        for (auto handle : ready) {
+            handle.resume();
+        }
+        std::this_thread::yield();
+    }
+    return by_callback >= n && refused && resumed_here && by_await == (n + 1) * 10000 + n + 2;
+}
+
+// 37. 上下文字段: log_context 作用域内本线程的日志都带上字段 (含调用线程格式化的消息), 出作用域后移除, 其他线程不受影响
+bool test_log_context() {
+    using L = huxint::Logger<"Context">;
+    const auto path = std::filesystem::temp_directory_path() / "huxint_context.log";
+    const auto json_path = std::filesystem::temp_directory_path() / "huxint_context.jsonl";
+    std::filesystem::remove(path);
+    std::filesystem::remove(json_path);
+    L::add_sink<huxint::FileSink>(path.string());
+    L::add_sink<huxint::JsonSink>(json_path.string());
+
+    L::info("plain");
+    {
+        const auto request = huxint::log_context("req", 42);
+        L::info("a {}", 1);
+        {
+            const auto tenant = huxint::log_context("tenant", std::string("acme"));
+            L::info("b {}", huxint::kv("k", 2));
+            L::info("p {}", Point{1, 2});
+            L::flush();
+            std::jthread([] {
+                L::info("other");
+            }).join();
+            L::flush();
+        }
+        L::info("c");
+    }
+    L::info("d");
+    L::flush();
+
+    std::vector<std::string> lines;
+    std::ifstream in(path);
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    std::string last_json;
+    std::ifstream json_in(json_path);
+    for (std::string line; std::getline(json_in, line);) {
+        if (line.contains(R"("msg":"p (1, 2)")")) {
+            last_json = line;
+        }
+    }
+    return lines.size() == 7 && lines[0].ends_with(" plain") && lines[1].ends_with(" a 1 req=42") &&
+           lines[2].ends_with(" b 2 k=2 req=42 tenant=acme") && lines[3].ends_with(" p (1, 2) req=42 tenant=acme") &&
+           lines[4].ends_with(" other") && lines[5].ends_with(" c req=42") && lines[6].ends_with(" d") &&
+           last_json.ends_with(R"("msg":"p (1, 2)","req":42,"tenant":"acme"})");
+}
+
 int main() {
     Test tests[] = {
         {"Concurrent logging", test_concurrent},
@@ -292,8 +1390,33 @@ int main() {
         {"Multiple sinks", test_multiple_sinks},
         {"Thread pool config", test_thread_pool},
         {"Format arguments", test_format_args},
+        {"Deferred arguments", test_deferred_args},
         {"Stress test", test_stress},
         {"Data integrity", test_integrity},
+        {"File sink batch", test_file_batch},
+        {"Posix file sink", test_posix_file_sink},
+        {"Timestamp cache", test_timestamp_cache},
+        {"Allocations per sink", test_allocations_per_sink},
+        {"Pattern layout", test_pattern},
+        {"Compile-time level", test_compile_time_level},
+        {"Overflow policies", test_overflow},
+        {"Sink worker ordering", test_worker_ordering},
+        {"Rotating file sink", test_rotating_file_sink},
+        {"LZ roundtrip", test_lz_roundtrip},
+        {"Binary file sink", test_binary_file_sink},
+        {"Fatal write-through", test_fatal_write_through},
+        {"Crash handler", test_crash_handler},
+        {"Logger registry", test_registry},
+        {"Metrics", test_metrics},
+        {"Zero allocation", test_zero_allocation},
+        {"Structured fields", test_structured_fields},
+        {"Producer isolation", test_producer_isolation},
+        {"Call site limits", test_call_site_limits},
+        {"Backtrace", test_backtrace},
+        {"Console redirect", test_console_redirect},
+        {"Sink levels", test_sink_levels},
+        {"Async flush", test_async_flush},
+        {"Log context", test_log_context},
     };
 
     int passed = 0;